@@ -0,0 +1,41 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Common helpers for buggy comparator corpus.
+// Each program is invoked as `prog N SEED`, generates N elements
+// from SEED, sorts them once and prints number of comparator calls.
+
+#ifndef BENCH_DETECT_COMMON_H
+#define BENCH_DETECT_COMMON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static unsigned long ncalls;
+
+static unsigned long long rng_state;
+
+// Do not use rand() to avoid interference with checker
+static unsigned rnd(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return (unsigned)((rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static size_t bench_init(int argc, char **argv) {
+  size_t n = argc > 1 ? (size_t)atol(argv[1]) : 100;
+  unsigned seed = argc > 2 ? (unsigned)atol(argv[2]) : 1;
+  rng_state = 0x9E3779B97F4A7C15ULL * (seed + 1);
+  return n;
+}
+
+static void bench_done(void) {
+  printf("calls %lu\n", ncalls);
+}
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Floating-point comparator which treats close values as equal
+// (so equivalence is not transitive).
+
+#include "common.h"
+
+#include <math.h>
+
+#define EPS 1.0
+
+static int cmp(const void *pa, const void *pb) {
+  ++ncalls;
+  double a = *(const double *)pa;
+  double b = *(const double *)pb;
+  if(fabs(a - b) < EPS)
+    return 0;
+  return a < b ? -1 : 1;
+}
+
+int main(int argc, char **argv) {
+  size_t i, n = bench_init(argc, argv);
+  double *aa = malloc(n * sizeof(double));
+  // Average distance between neighbors is about EPS / 2
+  for(i = 0; i < n; ++i)
+    aa[i] = (double)rnd() / 0xffffffffu * n * EPS / 2;
+  qsort(aa, n, sizeof(double), cmp);
+  bench_done();
+  return 0;
+}
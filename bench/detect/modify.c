@@ -0,0 +1,43 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Comparator which normalizes (lowercases) strings in place.
+
+#include "common.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#define LEN 16
+
+static void normalize(char *s) {
+  for(; *s; ++s)
+    *s = tolower(*s);
+}
+
+static int cmp(const void *pa, const void *pb) {
+  ++ncalls;
+  char *a = (char *)pa, *b = (char *)pb;
+  normalize(a);
+  normalize(b);
+  return strcmp(a, b);
+}
+
+int main(int argc, char **argv) {
+  size_t i, j, n = bench_init(argc, argv);
+  char (*aa)[LEN] = malloc(n * LEN);
+  // Few strings are not normalized
+  for(i = 0; i < n; ++i) {
+    int upper = rnd() % 32 == 0;
+    for(j = 0; j < LEN - 1; ++j)
+      aa[i][j] = (upper ? 'A' : 'a') + rnd() % 26;
+    aa[i][LEN - 1] = 0;
+  }
+  qsort(aa, n, LEN, cmp);
+  bench_done();
+  return 0;
+}
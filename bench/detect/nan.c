@@ -0,0 +1,31 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Floating-point comparator which does not handle NaNs
+// (NaN is "equal" to everything).
+
+#include "common.h"
+
+#include <math.h>
+
+static int cmp(const void *pa, const void *pb) {
+  ++ncalls;
+  double a = *(const double *)pa;
+  double b = *(const double *)pb;
+  return a < b ? -1 : a > b;
+}
+
+int main(int argc, char **argv) {
+  size_t i, n = bench_init(argc, argv);
+  double *aa = malloc(n * sizeof(double));
+  // Few NaNs among normal values
+  for(i = 0; i < n; ++i)
+    aa[i] = rnd() % 16 == 0 ? NAN : (double)rnd();
+  qsort(aa, n, sizeof(double), cmp);
+  bench_done();
+  return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Comparator which breaks ties by subtracting unrelated pointers
+// and truncating result to int (similar to Cpio's HOL_ENTRY_PTRCMP).
+
+#include "common.h"
+
+typedef struct {
+  int key;
+  const char *name;
+} Entry;
+
+static char static_names[64];
+
+static int cmp(const void *pa, const void *pb) {
+  ++ncalls;
+  const Entry *a = pa, *b = pb;
+  if(a->key != b->key)
+    return a->key < b->key ? -1 : 1;
+  return (int)(a->name - b->name);
+}
+
+int main(int argc, char **argv) {
+  size_t i, n = bench_init(argc, argv);
+  Entry *aa = malloc(n * sizeof(Entry));
+  // Names come from static data, small heap blocks and large (mmapped)
+  // heap blocks which are far apart in address space
+  char *small = malloc(64), *large = malloc(1 << 24);
+  for(i = 0; i < n; ++i) {
+    aa[i].key = rnd() % 4;
+    switch(rnd() % 3) {
+    case 0:
+      aa[i].name = static_names + rnd() % sizeof(static_names);
+      break;
+    case 1:
+      aa[i].name = small + rnd() % 64;
+      break;
+    default:
+      aa[i].name = large + rnd() % (1 << 24);
+      break;
+    }
+  }
+  qsort(aa, n, sizeof(Entry), cmp);
+  bench_done();
+  return 0;
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Comparator which returns difference of ints
+// (overflows for values of different signs).
+
+#include "common.h"
+
+static int cmp(const void *pa, const void *pb) {
+  ++ncalls;
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  return a - b;
+}
+
+int main(int argc, char **argv) {
+  size_t i, n = bench_init(argc, argv);
+  int *aa = malloc(n * sizeof(int));
+  for(i = 0; i < n; ++i)
+    aa[i] = (int)rnd();
+  qsort(aa, n, sizeof(int), cmp);
+  bench_done();
+  return 0;
+}
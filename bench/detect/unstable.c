@@ -0,0 +1,30 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Comparator whose result for equal keys depends on global state
+// (e.g. on stale cache).
+
+#include "common.h"
+
+static int cmp(const void *pa, const void *pb) {
+  ++ncalls;
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  if(a != b)
+    return a < b ? -1 : 1;
+  return ncalls % 7 == 0;
+}
+
+int main(int argc, char **argv) {
+  size_t i, n = bench_init(argc, argv);
+  int *aa = malloc(n * sizeof(int));
+  for(i = 0; i < n; ++i)
+    aa[i] = rnd() % (n / 4 + 1);
+  qsort(aa, n, sizeof(int), cmp);
+  bench_done();
+  return 0;
+}
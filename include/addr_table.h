@@ -0,0 +1,32 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef ADDR_TABLE_H
+#define ADDR_TABLE_H
+
+#include <stddef.h>
+
+// Lock-free open-addressing table of statically allocated
+// elements keyed by address (which must be first field of element).
+// Elements are never removed.
+typedef struct {
+  char *elems;
+  size_t elem_size, size;
+  int *states;
+} AddrTable;
+
+#define ADDR_TABLE_INIT(elems, states) { (char *)(elems), sizeof((elems)[0]), sizeof(elems) / sizeof((elems)[0]), (states) }
+
+// Find or create element with given key
+// (returns NULL if table is full or slot is being filled
+// by another thread).
+void *addr_table_get(AddrTable *t, const void *key);
+
+// Iterate over all elements (start with NULL)
+void *addr_table_next(AddrTable *t, const void *prev);
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef BACKTRACE_H
+#define BACKTRACE_H
+
+#include <stddef.h>  // size_t
+
+#define MAX_BACKTRACE_DEPTH 16
+
+typedef struct {
+  unsigned hash;
+  unsigned depth;
+  const void *frames[MAX_BACKTRACE_DEPTH];
+} Stack;
+
+// Collect return addresses by walking frame pointers,
+// starting from return address of the caller.
+// Walk stops at first frame which does not look sane
+// (so it's safe to call from code without frame pointers).
+size_t get_backtrace(const void **frames, size_t max_depth);
+
+unsigned hash_backtrace(const void *const *frames, size_t depth);
+
+// Store stack in global de-duplicated table
+// (returns NULL if table is full).
+const Stack *intern_backtrace(const void *const *frames, size_t depth, unsigned hash);
+
+// Return bounds of current thread's stack (0 on failure)
+int get_stack_bounds(const void **lo, const void **hi);
+
+#endif
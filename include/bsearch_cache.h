@@ -0,0 +1,22 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef BSEARCH_CACHE_H
+#define BSEARCH_CACHE_H
+
+#include <stddef.h>  // size_t
+
+// Cache of arrays which have already been verified
+// (to avoid rechecking arrays which are repeatedly bsearched).
+// Arrays are identified by address, size and comparator;
+// modifications are detected via fingerprint of sampled elements.
+
+int bsearch_cache_lookup(const void *data, size_t n, size_t sz, const void *cmp);
+
+void bsearch_cache_insert(const void *data, size_t n, size_t sz, const void *cmp);
+
+#endif
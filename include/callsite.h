@@ -0,0 +1,86 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef CALLSITE_H
+#define CALLSITE_H
+
+#include <flags.h>
+#include <perf.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of block checksums kept for previous sorted output
+#define SORTED_BLOCKS 32
+
+// Number of log2 buckets in histogram of array sizes
+#define SIZE_HIST_BUCKETS 32
+
+// Kinds of misuse found by lint=usage
+enum UsageIssue {
+  USAGE_LINEAR_SEARCH = 1 << 0,  // lfind/lsearch over large table
+  USAGE_SMALL_BSEARCH = 1 << 1,  // bsearch over few elements
+  USAGE_LARGE_ELEMS   = 1 << 2,  // Sort of large elements
+};
+
+// Per-callsite state (keyed by return address of interceptor)
+typedef struct {
+  const void *ret_addr;
+  // Value of dlopen_gen when policy was resolved (high half)
+  // and index of policy plus 1 (low half, 0 if no policy matches);
+  // packed so that concurrent callers never see mismatched pair
+  // (0 - never resolved).
+  uint64_t policy_gen;
+  unsigned ncalls, nchecked;
+  // Window rotation (start=rotate)
+  size_t last_n;    // Array size in previous call
+  size_t nwindows;  // Number of windows in array of last_n elements
+  size_t cursor;    // Number of windows checked since last_n changed
+  // Previous sorted output (incremental=1)
+  const void *sorted_data;
+  const void *sorted_cmp, *sorted_arg;
+  size_t sorted_n, sorted_sz;
+  unsigned sorted_cs[SORTED_BLOCKS];  // Checksums of equal-sized blocks
+  // Sampled basic and uniqueness checks (sample=K)
+  unsigned nsampled;
+  size_t max_sampled_n;  // Largest sampled array
+  // Counters for each stage (perf=1, allocated on first use)
+  PerfTotal *perf;
+  // Comparisons made by libc functions (cmp_cost=C)
+  unsigned ncounted;
+  uint64_t ncmp, cmp_ticks;
+  uint64_t nexpected;  // Sum of n*log2(n) (or log2(n) + 1 for search)
+  // Redundant sorts (lint=redundant)
+  unsigned nlinted, nsorted_input, nrepeated_input;
+  uint64_t last_input_hash;
+  uint64_t wasted_cmp, wasted_bytes;  // Estimated
+  // Distributions of call parameters (lint=usage)
+  const char *func;
+  unsigned nused;
+  unsigned n_hist[SIZE_HIST_BUCKETS];  // Bucket k counts n in [2^(k-1), 2^k)
+  uint64_t sum_n, max_n;
+  size_t max_sz;
+  uint64_t first_ns, last_ns;
+  unsigned issues;
+  uint64_t usage_waste;  // Estimated, in comparisons
+  // Modules of comparator and caller (trace=PREFIX), resolved
+  // on first use and guarded by seqlock (odd - update in progress)
+  unsigned trace_seq;
+  int trace_gen;  // Value of dlopen_gen when modules were resolved
+  const void *trace_cmp;
+  uint32_t trace_cmp_module, trace_caller_module;
+  uint64_t trace_cmp_offset, trace_caller_offset;
+} Callsite;
+
+// Find or create callsite in global table
+// (returns NULL if table is full or slot is busy).
+Callsite *get_callsite(const void *ret_addr);
+
+// Iterate over all callsites (start with NULL)
+Callsite *next_callsite(Callsite *prev);
+
+#endif
@@ -0,0 +1,237 @@
+/*
+ * Copyright 2015-2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef CHECKER_H
+#define CHECKER_H
+
+#include <backtrace.h>
+#include <callsite.h>
+#include <flags.h>
+#include <perf.h>
+#include <perm.h>
+#include <probes.h>
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef int (*cmp_fun_t)(const void *, const void *);
+typedef int (*cmp_r_fun_t)(const void *, const void *, void *);
+
+typedef struct {
+  const char *func;
+  const void *cmp_addr;
+  const char *cmp_module;
+  size_t cmp_offset;
+  const void *ret_addr;
+  const char *caller_module;
+  size_t caller_offset;
+  int found_error;
+  const void *const *frames;
+  size_t depth;
+  unsigned stack_hash;
+  // Elements in this range are write-protected
+  // so need not be checksummed
+  const char *prot_begin, *prot_end;
+  // Set when policies are used
+  Callsite *callsite;
+  const Policy *policy;
+  // Set for escalated comparators (tiered=1)
+  int deep;
+  struct CmpState *cmp_state;  // NULL if table is full
+  // Input of current check (saved on error when dump_dir is set)
+  const char *dump_data;
+  const size_t *dump_idx;  // Indices of checked elements (0 - all)
+  const char *dump_key;  // Key of search functions (0 - none)
+  size_t dump_n, dump_sz;
+  int dump_reentrant;
+} ErrorContext;
+
+typedef struct {
+  void *cmp;
+  void *arg;
+  int is_reentrant;
+} Comparator;
+
+// Comparator call made by checker
+static inline int cmp_eval(const Comparator *cmp, const void *a, const void *b) {
+  int res = cmp->is_reentrant ? ((cmp_r_fun_t)cmp->cmp)(a, b, cmp->arg) : ((cmp_fun_t)cmp->cmp)(a, b);
+  PROBE4(cmp__call, cmp->cmp, a, b, res);
+  return res;
+}
+
+// Remember input of check for dump_dir
+// (valid until end of check).
+static inline void set_dump_input(ErrorContext *ctx, const Comparator *cmp, const char *key, const void *data, const size_t *idx, size_t n, size_t sz) {
+  ctx->dump_data = data;
+  ctx->dump_idx = idx;
+  ctx->dump_key = key;
+  ctx->dump_n = n;
+  ctx->dump_sz = sz;
+  ctx->dump_reentrant = cmp->is_reentrant;
+}
+
+static inline void reset_dump_input(ErrorContext *ctx) {
+  ctx->dump_data = 0;
+  ctx->dump_idx = 0;
+  ctx->dump_key = 0;
+}
+
+static inline int sign(int x) {
+  return x < 0 ? -1 : x > 0 ? 1 : 0;
+}
+
+// Ceil of log2(n)
+static inline unsigned log2_ceil(size_t n) {
+  return n > 1 ? 8 * sizeof(unsigned long long) - __builtin_clzll(n - 1) : 0;
+}
+
+// Collect backtrace for de-duplication of reports
+// (must be called directly from interceptor).
+#define CAPTURE_STACK(ctx)                                           \
+  const void *_frames[MAX_BACKTRACE_DEPTH];                          \
+  if(flags.backtrace) {                                              \
+    (ctx).depth = get_backtrace(_frames, flags.backtrace);           \
+    (ctx).frames = _frames;                                          \
+    (ctx).stack_hash = hash_backtrace(_frames, (ctx).depth);         \
+  }
+
+// USDT probes at interceptor entry and exit
+#define PROBE_ENTRY(ctx, n, sz) \
+  PROBE5(interceptor__entry, (ctx).func, n, sz, (ctx).cmp_addr, (ctx).ret_addr)
+#define PROBE_EXIT(ctx) \
+  PROBE2(interceptor__exit, (ctx).func, (ctx).found_error)
+
+// Stages for which performance counters are collected (perf=1)
+typedef enum {
+  STAGE_REAL,  // Intercepted libc function
+  STAGE_BASIC,
+  STAGE_TOTAL_ORDER,
+  STAGE_WINDOW,
+  STAGE_SORTED,
+  STAGE_UNIQUE,
+  STAGE_BSEARCH_PATH,
+  STAGE_TIER0,
+  NUM_STAGES
+} Stage;
+
+// Runtime options
+extern Flags flags;
+extern FILE *out;
+
+extern volatile int init_in_progress, init_done;
+
+// Incremented on dlopen/dlclose to invalidate cached process maps
+extern int dlopen_gen;
+
+// Checking parameters for current call
+// (depend on policy for caller's module)
+
+// Checks and min. window for escalated comparators
+#define DEEP_CHECKS (CHECK_BASIC | CHECK_SYMMETRY | CHECK_TRANSITIVITY | CHECK_SORTED | CHECK_UNIQUE)
+#define DEEP_WINDOW 128
+
+static inline unsigned get_checks(const ErrorContext *ctx) {
+  unsigned checks = ctx->policy && ctx->policy->has_checks ? ctx->policy->checks : flags.checks;
+  return ctx->deep ? checks | DEEP_CHECKS : checks;
+}
+
+static inline unsigned get_budget(const ErrorContext *ctx) {
+  return ctx->policy ? ctx->policy->budget : 0;
+}
+
+// Window size is limited by budget (window^2 comparisons)
+static inline unsigned get_window(const ErrorContext *ctx) {
+  unsigned window = ctx->policy && ctx->policy->window ? ctx->policy->window : flags.window;
+  if(ctx->deep && window < DEEP_WINDOW)
+    window = DEEP_WINDOW;
+  unsigned budget = get_budget(ctx);
+  while(budget && window > 2 && window * window > budget / 2)
+    window /= 2;
+  return window;
+}
+
+// Parse options from /SORTCHECK_OPTIONS and environment
+void init(void);
+
+// Whether errors for this context should not be checked
+// (already reported, limit of reports exceeded or disabled by policy).
+// Also selects policy for context.
+int suppress_errors(ErrorContext *ctx);
+
+void report_error(ErrorContext *ctx, const char *fmt, ...)
+  __attribute__((format(printf, 2, 3)));
+
+const Perm *get_perm(Perm *p, const ErrorContext *ctx, size_t n);
+
+void check_basic(ErrorContext *ctx, const Comparator *cmp, const Perm *perm, const char *key, const void *data, size_t n, size_t sz);
+void check_uniqueness(ErrorContext *ctx, const Comparator *cmp, const void *data, size_t n, size_t sz);
+void check_sorted(ErrorContext *ctx, const Comparator *cmp, const char *key, const void *data, size_t n, size_t sz);
+void check_bsearch_path(ErrorContext *ctx, const Comparator *cmp, const char *key, const void *data, size_t n, size_t sz);
+void check_window(ErrorContext *ctx, const Comparator *cmp, const void *data, size_t sz, const size_t *idx, size_t n);
+void check_total_order(ErrorContext *ctx, const Comparator *cmp, const Perm *perm, const char *key, const void *data, size_t n, size_t sz);
+void check_total_order_tail(ErrorContext *ctx, const Comparator *cmp, const void *data, size_t old_n, size_t n, size_t sz);
+
+// Checks which are done before and after sorting
+void check_sort_input(ErrorContext *ctx, const Comparator *cmp, void *data, size_t n, size_t sz);
+void check_sort_output(ErrorContext *ctx, const Comparator *cmp, void *data, size_t n, size_t sz);
+
+// Add counters accumulated since start to callsite totals
+void perf_account(const ErrorContext *ctx, Stage stage, const PerfSample *start);
+
+static inline void perf_begin(PerfSample *s) {
+  if(flags.perf)
+    perf_read(s);
+}
+
+static inline void perf_end(const ErrorContext *ctx, Stage stage, const PerfSample *s) {
+  if(flags.perf)
+    perf_account(ctx, stage, s);
+}
+
+// Modules which contain addresses and offsets in them
+void get_module_offsets(const void *const *addrs, size_t naddrs, const char **modules, size_t *offsets);
+
+// Timestamps of intercepted call (trace=PREFIX)
+typedef struct {
+  uint64_t start, real_start, real_end;
+} TraceSpan;
+
+static inline uint64_t trace_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline void trace_begin(TraceSpan *t) {
+  if(flags.trace_prefix)
+    t->start = trace_now();
+}
+
+static inline void trace_real_begin(TraceSpan *t) {
+  if(flags.trace_prefix)
+    t->real_start = trace_now();
+}
+
+static inline void trace_real_end(TraceSpan *t) {
+  if(flags.trace_prefix)
+    t->real_end = trace_now();
+}
+
+// Append record for finished call to trace of current thread
+void trace_call(const ErrorContext *ctx, const TraceSpan *t, size_t n, size_t sz);
+
+static inline void trace_end(const ErrorContext *ctx, const TraceSpan *t, size_t n, size_t sz) {
+  if(flags.trace_prefix)
+    trace_call(ctx, t, n, sz);
+}
+
+int protect_data(ErrorContext *ctx, void *data, size_t n, size_t sz);
+void unprotect_data(ErrorContext *ctx);
+
+#endif
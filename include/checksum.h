@@ -9,8 +9,29 @@
 #define CHECKSUM_H
 
 #include <stddef.h>  // size_t
+#include <stdint.h>
 
 // Fletcher's checksum
 unsigned checksum(const void *data, size_t sz);
 
+#define FNV1A_INIT 0xcbf29ce484222325ull
+
+static inline uint64_t fnv1a(uint64_t h, const void *p, size_t sz) {
+  const uint8_t *b = p;
+  size_t i;
+  for(i = 0; i < sz; ++i) {
+    h ^= b[i];
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+// Hash of full content (processes 8 bytes at a time
+// so much faster than fnv1a on large arrays)
+uint64_t hash_words(uint64_t h, const void *data, size_t sz);
+
+// Cheap fingerprint of array (hash of first, last
+// and several evenly spaced elements)
+uint64_t fingerprint(const void *data, size_t n, size_t sz);
+
 #endif
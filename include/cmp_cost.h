@@ -0,0 +1,54 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef CMP_COST_H
+#define CMP_COST_H
+
+#include <checker.h>
+
+#include <stdint.h>
+#include <time.h>
+
+// Counting of comparisons made by libc functions (cmp_cost=C):
+// user's comparator is replaced by shim which counts and times calls.
+
+// Cheap timestamp (TSC ticks if available, otherwise nanoseconds)
+static inline uint64_t read_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+  uint64_t t;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(t));
+  return t;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+typedef struct CmpShim_ {
+  Comparator c;  // Wrapped comparator
+  uint64_t ncmp, ticks;
+  struct CmpShim_ *prev;  // Shim of enclosing call (comparators may sort too)
+  // Shim as reentrant comparator (for replace_sort=1)
+  Comparator shim_c;
+} CmpShim;
+
+// Shims which are passed to libc instead of user's comparator
+// (cmp_shim must be enclosed in cmp_shim_begin/cmp_shim_end).
+int cmp_shim(const void *a, const void *b);
+int cmp_shim_r(const void *a, const void *b, void *arg);
+
+void cmp_shim_begin(CmpShim *s, const Comparator *c);
+
+// Add counters to callsite totals and, if report is set,
+// report calls which made more comparisons than expected
+// for sort (or search) of n elements.
+void cmp_shim_end(ErrorContext *ctx, CmpShim *s, size_t n, int is_search, int report);
+
+#endif
@@ -0,0 +1,31 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef CMP_STATE_H
+#define CMP_STATE_H
+
+// Checks which are run for escalated comparators (tiered=1)
+typedef enum {
+  DEEP_BASIC,
+  DEEP_TOTAL_ORDER,
+  DEEP_SORTED,
+  DEEP_UNIQUE,
+  NUM_DEEP_CHECKS
+} DeepCheck;
+
+// Per-comparator state (keyed by comparator address)
+typedef struct CmpState {
+  const void *cmp;
+  unsigned escalated;  // Number of remaining calls at deep tier
+  unsigned fired[NUM_DEEP_CHECKS];  // Number of errors found by each check
+} CmpState;
+
+// Find or create comparator in global table
+// (returns NULL if table is full or slot is busy).
+CmpState *get_cmp_state(const void *cmp);
+
+#endif
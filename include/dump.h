@@ -0,0 +1,59 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef DUMP_H
+#define DUMP_H
+
+#include <stddef.h>  // size_t
+#include <stdint.h>
+
+// Binary dump of counterexample (dump_dir=DIR) which is analyzed
+// offline by sortcheck-replay. File consists of header followed by
+// null-terminated strings (function name, comparator's module,
+// options and error message), raw array elements and key
+// of search functions (if any).
+
+#define DUMP_MAGIC "SCDUMP1"
+
+// Limits on dumped data (so that single write is cheap)
+#define DUMP_MAX_ELEMS 1024
+#define DUMP_MAX_BYTES (1 << 20)
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t is_reentrant;
+  uint64_t n;       // Number of dumped elements
+  uint64_t orig_n;  // Size of original array
+  uint64_t sz;
+  uint64_t cmp_offset;
+  uint64_t caller_offset;
+  uint32_t seed;    // Value of shuffle option
+  uint32_t pid;
+  uint32_t func_len, module_len, opts_len, msg_len;  // Including null
+  uint32_t has_key;  // Key of size sz follows elements
+} DumpHeader;
+
+typedef struct {
+  DumpHeader hdr;
+  const char *func, *module, *opts, *msg;
+  const char *data;
+  const char *key;  // NULL if not dumped
+  char *buf;  // Owns all of the above
+} Dump;
+
+// Write dump to new file in dir (with a single write).
+// Elements are taken from data (at indices idx if non-null).
+// Returns 0 on error.
+int write_dump(const char *dir, DumpHeader *hdr, const char *func, const char *module, const char *opts, const char *msg, const char *data, const size_t *idx, const char *key, char *fname, size_t fname_size);
+
+// Returns 0 if file is missing or malformed
+int read_dump(const char *fname, Dump *d);
+
+void free_dump(Dump *d);
+
+#endif
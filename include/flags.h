@@ -24,17 +24,62 @@ enum CheckFlags {
   CHECK_ALL          = 0xffffffff,
 };
 
+enum LintFlags {
+  LINT_REDUNDANT = 1 << 0,
+  LINT_USAGE     = 1 << 1,
+};
+
+// Upper limit for max_errors
+#define MAX_ERRORS 1024
+
+// Upper limit for window
+#define MAX_WINDOW 1024
+
+// Upper limit for number of policies
+#define MAX_POLICIES 16
+
+// Checking policy for callers from modules matching glob
+typedef struct {
+  const char *glob;
+  unsigned char has_checks : 1;
+  unsigned checks;
+  unsigned window;  // 0 - use global setting
+  unsigned budget;  // Max comparator calls per call (0 - unlimited)
+  unsigned rate;    // Check only every rate-th call (0 - all calls)
+} Policy;
+
 typedef struct {
   unsigned char debug : 1;
   unsigned char report_error : 1;
   unsigned char print_to_syslog : 1;
   unsigned char raise : 1;
+  unsigned char bsearch_cache : 1;
+  unsigned char lsearch_cache : 1;
+  unsigned char bsearch_path : 1;
+  unsigned char protect : 1;
+  unsigned char rotate : 1;
+  unsigned char print_stats : 1;
+  unsigned char incremental : 1;
+  unsigned char tiered : 1;
+  unsigned char perf : 1;
+  unsigned char replace_sort : 1;
   unsigned max_errors;
   unsigned sleep;
   unsigned checks;
   unsigned start;
   unsigned shuffle;
+  unsigned backtrace;
+  unsigned window;
+  unsigned threads;
+  unsigned escalate;
+  unsigned sample;
+  unsigned cmp_cost;
+  unsigned lint;
   const char *out_filename;
+  const char *dump_dir;
+  const char *trace_prefix;
+  unsigned npolicies;
+  Policy policies[MAX_POLICIES];
 } Flags;
 
 int parse_flags(char *opts, Flags *flags);
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef INTERCEPT_H
+#define INTERCEPT_H
+
+#include <checker.h>
+
+// Bodies of interceptors: checks, lints, counters and tracing
+// around call to real libc function. Shared by LD_PRELOAD
+// interceptors (sortchecker.c) and link-time wrappers (api.c)
+// so that both get the same functionality.
+// Callers initialize ctx (and capture stack).
+
+// Calls real sort function with given comparator
+// (which may be a shim when comparisons are counted).
+typedef int (*sort_call_t)(void *real, void *data, size_t n, size_t sz, const Comparator *c);
+
+// Adapters for common signatures of real functions
+int call_qsort(void *real, void *data, size_t n, size_t sz, const Comparator *c);
+int call_bsd_sort(void *real, void *data, size_t n, size_t sz, const Comparator *c);
+int call_qsort_r(void *real, void *data, size_t n, size_t sz, const Comparator *c);
+
+int checked_sort(ErrorContext *ctx, const Comparator *c, void *data, size_t n, size_t sz, int stable, sort_call_t call, void *real);
+
+typedef void *bsearch_fun_t(const void *key, const void *data, size_t n, size_t sz, cmp_fun_t cmp);
+
+void *checked_bsearch(ErrorContext *ctx, const void *key, const void *data, size_t n, size_t sz, cmp_fun_t cmp, bsearch_fun_t *real);
+
+// Signature of lfind and lsearch
+typedef void *lsearch_fun_t(const void *key, void *data, size_t *n, size_t sz, cmp_fun_t cmp);
+
+void *checked_lsearch(ErrorContext *ctx, const void *key, void *data, size_t *n, size_t sz, cmp_fun_t cmp, lsearch_fun_t *real);
+
+#endif
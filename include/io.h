@@ -12,4 +12,8 @@
 
 char *read_file(const char *fname, size_t *plen);
 
+// Read file to buffer (at most size - 1 bytes) with single read
+// and null-terminate it. Returns number of read bytes.
+size_t read_file_to_buf(const char *fname, char *buf, size_t size);
+
 #endif
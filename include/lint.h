@@ -0,0 +1,25 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef LINT_H
+#define LINT_H
+
+#include <checker.h>
+
+// Performance lints (lint=...): wasteful usage of libc functions
+// is accumulated per callsite and printed at exit.
+
+// Detect sorting of already sorted input or of same content
+// as in previous call from this callsite (lint=redundant).
+void lint_sort_input(ErrorContext *ctx, const Comparator *cmp, const void *data, size_t n, size_t sz);
+
+// Collect distributions of n, sz and call frequency
+// and estimate work wasted due to unsuitable algorithm
+// (lint=usage).
+void lint_usage(ErrorContext *ctx, size_t n, size_t sz);
+
+#endif
@@ -0,0 +1,24 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef LSEARCH_CACHE_H
+#define LSEARCH_CACHE_H
+
+#include <stddef.h>  // size_t
+
+// Cache of tables which have already been partially verified
+// in lfind/lsearch (tables are typically built by repeated lsearch
+// so only newly appended elements need to be checked).
+// Tables are identified by address, element size and comparator;
+// modifications of verified part are detected via fingerprint.
+
+// Returns number of leading elements which have already been verified
+size_t lsearch_cache_lookup(const void *data, size_t n, size_t sz, const void *cmp);
+
+void lsearch_cache_insert(const void *data, size_t n, size_t sz, const void *cmp);
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+
+// Hardware performance counters of current thread (perf=1)
+
+enum {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_LLC_MISSES,
+  PERF_BRANCH_MISSES,
+  NUM_PERF_COUNTERS
+};
+
+extern const char *const perf_counter_names[NUM_PERF_COUNTERS];
+
+typedef struct {
+  uint64_t val[NUM_PERF_COUNTERS];
+} PerfSample;
+
+// Accumulated counters
+typedef struct {
+  uint64_t ncalls;
+  uint64_t val[NUM_PERF_COUNTERS];
+} PerfTotal;
+
+// Read counters of current thread (they are opened on first call);
+// counters which could not be opened read as 0.
+void perf_read(PerfSample *s);
+
+// Mask of counters which were successfully opened in some thread
+unsigned perf_available(void);
+
+#endif
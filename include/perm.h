@@ -0,0 +1,30 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef PERM_H
+#define PERM_H
+
+#include <stddef.h>  // size_t
+#include <stdint.h>
+
+// Pseudo-random bijection over [0, n)
+// (balanced Feistel network with cycle walking).
+typedef struct {
+  size_t n;
+  unsigned half_bits;
+  uint64_t half_mask;
+  uint32_t keys[4];
+} Perm;
+
+void perm_init(Perm *p, size_t n, unsigned seed);
+
+size_t perm_apply(const Perm *p, size_t i);
+
+// Mix several values into a seed
+unsigned seed_mix(unsigned seed, uint64_t x);
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>  // size_t
+
+typedef void (*task_fun_t)(void *arg, size_t begin, size_t end);
+
+// Run fun over [0, n) in chunks of given size on a persistent pool
+// of nthreads threads (including the calling one).
+// Pool is started lazily. Work is run serially in calling thread
+// if pool is busy, unavailable (e.g. in fork child)
+// or job is too small.
+void pool_run(unsigned nthreads, task_fun_t fun, void *arg, size_t n, size_t chunk);
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef PROBES_H
+#define PROBES_H
+
+// SystemTap-compatible USDT probes (usable from bpftrace, perf, stap).
+// Each probe is a single nop plus ELF note which describes
+// location of arguments so it costs nothing when not attached.
+// All arguments are passed as word-sized integers.
+//
+// Uses <sys/sdt.h> if available, otherwise emits notes itself
+// (same format). Define NO_PROBES to disable.
+
+#if defined(NO_PROBES) || !defined(__ELF__)
+
+#define PROBE0(name) do {} while(0)
+#define PROBE1(name, a) do { (void)(a); } while(0)
+#define PROBE2(name, a, b) do { (void)(a); (void)(b); } while(0)
+#define PROBE3(name, a, b, c) do { (void)(a); (void)(b); (void)(c); } while(0)
+#define PROBE4(name, a, b, c, d) do { (void)(a); (void)(b); (void)(c); (void)(d); } while(0)
+#define PROBE5(name, a, b, c, d, e) do { (void)(a); (void)(b); (void)(c); (void)(d); (void)(e); } while(0)
+
+#elif defined(__has_include) && __has_include(<sys/sdt.h>)
+
+#include <sys/sdt.h>
+#include <stdint.h>
+
+#define PROBE_ARG(a) ((uintptr_t)(a))
+
+#define PROBE0(name) STAP_PROBE(sortcheck, name)
+#define PROBE1(name, a) STAP_PROBE1(sortcheck, name, PROBE_ARG(a))
+#define PROBE2(name, a, b) STAP_PROBE2(sortcheck, name, PROBE_ARG(a), PROBE_ARG(b))
+#define PROBE3(name, a, b, c) STAP_PROBE3(sortcheck, name, PROBE_ARG(a), PROBE_ARG(b), PROBE_ARG(c))
+#define PROBE4(name, a, b, c, d) STAP_PROBE4(sortcheck, name, PROBE_ARG(a), PROBE_ARG(b), PROBE_ARG(c), PROBE_ARG(d))
+#define PROBE5(name, a, b, c, d, e) STAP_PROBE5(sortcheck, name, PROBE_ARG(a), PROBE_ARG(b), PROBE_ARG(c), PROBE_ARG(d), PROBE_ARG(e))
+
+#else
+
+#include <stdint.h>
+
+// Note layout is described in
+// https://sourceware.org/systemtap/wiki/UserSpaceProbeImplementation
+// (no semaphores).
+
+#if UINTPTR_MAX == 0xffffffffu
+#define PROBE_ASM_ADDR ".4byte"
+#define PROBE_ARG_SIZE "4"
+#else
+#define PROBE_ASM_ADDR ".8byte"
+#define PROBE_ARG_SIZE "8"
+#endif
+
+#define PROBE_ASM(name, args)                                         \
+  "990: nop\n"                                                        \
+  ".pushsection .note.stapsdt,\"?\",\"note\"\n"                       \
+  ".balign 4\n"                                                       \
+  ".4byte 992f-991f, 994f-993f, 3\n"                                  \
+  "991: .asciz \"stapsdt\"\n"                                         \
+  "992: .balign 4\n"                                                  \
+  "993: " PROBE_ASM_ADDR " 990b\n"                                    \
+  PROBE_ASM_ADDR " _.stapsdt.base\n"                                  \
+  PROBE_ASM_ADDR " 0\n"                                               \
+  ".asciz \"sortcheck\"\n"                                            \
+  ".asciz \"" #name "\"\n"                                            \
+  ".asciz \"" args "\"\n"                                             \
+  "994: .balign 4\n"                                                  \
+  ".popsection\n"                                                     \
+  ".ifndef _.stapsdt.base\n"                                          \
+  ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+  ".weak _.stapsdt.base\n"                                            \
+  ".hidden _.stapsdt.base\n"                                          \
+  "_.stapsdt.base: .space 1\n"                                        \
+  ".size _.stapsdt.base, 1\n"                                         \
+  ".popsection\n"                                                     \
+  ".endif\n"
+
+#define PROBE_ARG(a) "nor"((uintptr_t)(a))
+#define PROBE_ARGS1 PROBE_ARG_SIZE "@%0"
+#define PROBE_ARGS2 PROBE_ARGS1 " " PROBE_ARG_SIZE "@%1"
+#define PROBE_ARGS3 PROBE_ARGS2 " " PROBE_ARG_SIZE "@%2"
+#define PROBE_ARGS4 PROBE_ARGS3 " " PROBE_ARG_SIZE "@%3"
+#define PROBE_ARGS5 PROBE_ARGS4 " " PROBE_ARG_SIZE "@%4"
+
+#define PROBE0(name) \
+  __asm__ __volatile__(PROBE_ASM(name, ""))
+#define PROBE1(name, a) \
+  __asm__ __volatile__(PROBE_ASM(name, PROBE_ARGS1) :: PROBE_ARG(a))
+#define PROBE2(name, a, b) \
+  __asm__ __volatile__(PROBE_ASM(name, PROBE_ARGS2) :: PROBE_ARG(a), PROBE_ARG(b))
+#define PROBE3(name, a, b, c) \
+  __asm__ __volatile__(PROBE_ASM(name, PROBE_ARGS3) :: PROBE_ARG(a), PROBE_ARG(b), PROBE_ARG(c))
+#define PROBE4(name, a, b, c, d) \
+  __asm__ __volatile__(PROBE_ASM(name, PROBE_ARGS4) :: PROBE_ARG(a), PROBE_ARG(b), PROBE_ARG(c), PROBE_ARG(d))
+#define PROBE5(name, a, b, c, d, e) \
+  __asm__ __volatile__(PROBE_ASM(name, PROBE_ARGS5) :: PROBE_ARG(a), PROBE_ARG(b), PROBE_ARG(c), PROBE_ARG(d), PROBE_ARG(e))
+
+#endif
+
+#endif
@@ -12,6 +12,7 @@
 
 typedef struct {
   const void *begin_addr, *end_addr;
+  int readable;  // Is first page readable?
   char name[128];
 } ProcMap;
 
@@ -21,4 +22,7 @@ const ProcMap *find_proc_map_for_addr(const ProcMap *maps, size_t n, const void
 
 void get_proc_cmdline(char **pname, char **pcmdline);
 
+// Kernel id of current thread (where available)
+unsigned long get_thread_id(void);
+
 #endif
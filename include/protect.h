@@ -0,0 +1,24 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef PROTECT_H
+#define PROTECT_H
+
+#include <stddef.h>  // size_t
+
+// Write-protect pages which are fully covered by [data, data + size)
+// so that writes from comparator are caught by SIGSEGV handler.
+// Only one range may be protected at a time.
+// Returns 0 if protection failed, otherwise stores protected
+// subrange in *pbegin and *pend.
+int protect_begin(void *data, size_t size, char **pbegin, char **pend);
+
+// Restore permissions; returns non-zero if writes to protected
+// range were detected.
+int protect_end(void);
+
+#endif
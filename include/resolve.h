@@ -0,0 +1,16 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef RESOLVE_H
+#define RESOLVE_H
+
+// Load shared object and find address of comparator in it.
+// SYMBOL may also be a hex offset (e.g. 0x1139) from module base,
+// as printed in reports. Errors are printed with given prefix.
+void *resolve_cmp(const char *prefix, const char *module, const char *sym);
+
+#endif
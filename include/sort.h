@@ -0,0 +1,20 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef SORT_H
+#define SORT_H
+
+#include <checker.h>
+
+#include <stddef.h>  // size_t
+
+// Sort array with own engine instead of libc (replace_sort=1).
+// Inconsistencies of comparator which are noticed during sorting
+// are reported if check is set.
+void sort_array(ErrorContext *ctx, const Comparator *cmp, void *data, size_t n, size_t sz, int stable, int check);
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Public API of SortChecker for explicit checking of comparators
+// (available both in libsortcheck.so and libsortcheck.a).
+
+#ifndef SORTCHECK_H
+#define SORTCHECK_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int (*sortcheck_cmp_fun_t)(const void *, const void *, void *);
+
+// Set options (same format as SORTCHECK_OPTIONS e.g. "check=all:window=64").
+// Returns zero on error.
+int sortcheck_set_options(const char *opts);
+
+// Check that comparator satisfies ordering axioms on array
+// which is about to be sorted.
+// Budget limits number of comparator calls (0 means no limit),
+// elements are sampled from different parts of array in consecutive calls.
+// Errors are reported in the usual way; return value is non-zero
+// if errors were found (errors beyond max_errors option
+// are neither reported nor counted).
+int sortcheck_verify(const void *data, size_t n, size_t sz, sortcheck_cmp_fun_t cmp, void *arg, size_t budget);
+
+// Check that array is sorted.
+int sortcheck_verify_sorted(const void *data, size_t n, size_t sz, sortcheck_cmp_fun_t cmp, void *arg, size_t budget);
+
+// Check that array is suitable for binary search of key.
+int sortcheck_verify_bsearch(const void *key, const void *data, size_t n, size_t sz, sortcheck_cmp_fun_t cmp, void *arg, size_t budget);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
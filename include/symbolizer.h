@@ -0,0 +1,33 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef SYMBOLIZER_H
+#define SYMBOLIZER_H
+
+#include <stddef.h>  // size_t
+
+typedef struct {
+  const char *func;
+  const char *file;
+  unsigned line;
+} SymbolInfo;
+
+// Directory where parsed symbol tables of modules are cached
+// (null or empty to disable caching).
+void set_symbolizer_cache(const char *dir);
+
+// Resolve offset in module (as printed in SortChecker reports)
+// to function name and source location using ELF symbol tables
+// and DWARF line info. Modules are parsed only once (on first request)
+// and parsed tables are memory-mapped from cache directory
+// in subsequent runs.
+// Returns 0 if nothing was found.
+int symbolize(const char *module, size_t offset, SymbolInfo *info);
+
+void release_symbolizer(void);
+
+#endif
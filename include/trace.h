@@ -0,0 +1,54 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// Format of workload traces (trace=PREFIX) which are read
+// by sortcheck-trace. Each thread writes its own file
+// PREFIX.PID.TID: header followed by fixed-size records.
+// Records with zero func terminate the trace (file is extended
+// in large chunks and may not be truncated if process crashes).
+
+#define TRACE_MAGIC "SCTRACE"
+
+typedef enum {
+  TRACE_NONE,
+  TRACE_QSORT,
+  TRACE_QSORT_R,
+  TRACE_HEAPSORT,
+  TRACE_MERGESORT,
+  TRACE_BSEARCH,
+  TRACE_LFIND,
+  TRACE_LSEARCH,
+  NUM_TRACE_FUNCS
+} TraceFunc;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t pid, tid;
+  uint64_t reserved[4];
+} TraceHeader;
+
+typedef struct {
+  uint64_t timestamp;  // CLOCK_MONOTONIC, ns
+  uint64_t n;
+  uint64_t cmp_offset, caller_offset;
+  uint64_t real_ns;   // Time in libc function
+  uint64_t check_ns;  // Time in checks
+  uint32_t cmp_module, caller_module;  // Hashes of module names
+  uint32_t sz;
+  uint8_t func;  // TraceFunc
+  uint8_t found_error;
+  uint16_t reserved;
+} TraceRecord;
+
+#endif
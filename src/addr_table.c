@@ -0,0 +1,55 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <addr_table.h>
+#include <perm.h>
+
+#include <stdint.h>
+
+enum { SLOT_EMPTY, SLOT_BUSY, SLOT_READY };
+
+static inline const void **get_key(AddrTable *t, size_t i) {
+  return (const void **)(t->elems + i * t->elem_size);
+}
+
+void *addr_table_get(AddrTable *t, const void *key) {
+  unsigned hash = seed_mix(0, (unsigned)((uintptr_t)key ^ ((uint64_t)(uintptr_t)key >> 32)));
+
+  size_t i, probe;
+  for(i = hash % t->size, probe = 0; probe < t->size; i = (i + 1) % t->size, ++probe) {
+    int state = __atomic_load_n(&t->states[i], __ATOMIC_ACQUIRE);
+
+    if(state == SLOT_EMPTY) {
+      if(__atomic_compare_exchange_n(&t->states[i], &state, SLOT_BUSY, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        *get_key(t, i) = key;
+        __atomic_store_n(&t->states[i], SLOT_READY, __ATOMIC_RELEASE);
+        return get_key(t, i);
+      }
+      // Lost the race, state now holds new value
+    }
+
+    // Slot is being filled by another thread (possibly for the same
+    // key). Do not wait for it and treat as miss: caller simply
+    // goes without state (same as when table is full).
+    if(state == SLOT_BUSY)
+      return NULL;
+
+    if(*get_key(t, i) == key)
+      return get_key(t, i);
+  }
+
+  return NULL;
+}
+
+void *addr_table_next(AddrTable *t, const void *prev) {
+  size_t i;
+  for(i = prev ? ((const char *)prev - t->elems) / t->elem_size + 1 : 0; i < t->size; ++i) {
+    if(__atomic_load_n(&t->states[i], __ATOMIC_ACQUIRE) == SLOT_READY)
+      return get_key(t, i);
+  }
+  return NULL;
+}
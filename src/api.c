@@ -0,0 +1,150 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Public API (see include/sortcheck.h)
+
+#include <sortcheck.h>
+#include <checker.h>
+#include <intercept.h>
+#include <platform.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Returns different seed in each call so that
+// consecutive calls check different parts of array
+static unsigned next_seed(const ErrorContext *ctx) {
+  static unsigned ncalls;
+  unsigned i = __atomic_fetch_add(&ncalls, 1, __ATOMIC_RELAXED);
+  return seed_mix((unsigned)(uintptr_t)ctx->ret_addr, i);
+}
+
+// Select random segment of len elements
+static size_t segment_start(unsigned seed, size_t n, size_t len) {
+  return seed % (n - len + 1);
+}
+
+// Check ordering axioms on random sample of elements
+static void check_sample(ErrorContext *ctx, const Comparator *cmp, unsigned seed, const void *data, size_t n, size_t sz, size_t nsample) {
+  size_t idx_buf[32];
+  size_t *idx = nsample <= 32 ? idx_buf : malloc(nsample * sizeof(size_t));
+  if(!idx)
+    return;
+
+  Perm p;
+  perm_init(&p, n, seed);
+
+  size_t i;
+  for(i = 0; i < nsample; ++i)
+    idx[i] = perm_apply(&p, i);
+
+  check_window(ctx, cmp, data, sz, idx, nsample);
+
+  if(idx != idx_buf)
+    free(idx);
+}
+
+EXPORT int sortcheck_set_options(const char *opts) {
+  char *buf = strdup(opts);
+  int res = parse_flags(buf, &flags);
+  free(buf);
+  return res;
+}
+
+EXPORT int sortcheck_verify(const void *data, size_t n, size_t sz, sortcheck_cmp_fun_t cmp, void *arg, size_t budget) {
+  ErrorContext ctx = { .func = __func__, .cmp_addr = cmp, .ret_addr = __builtin_return_address(0) };
+  Comparator c = { cmp, arg, 1 };
+
+  if(n < 2)
+    return 0;
+
+  if(!budget) {
+    Perm p;
+    const Perm *perm = get_perm(&p, &ctx, n);
+    check_basic(&ctx, &c, perm, 0, data, n, sz);
+    check_total_order(&ctx, &c, perm, 0, data, n, sz);
+    return ctx.found_error;
+  }
+
+  unsigned seed = next_seed(&ctx);
+
+  // Split budget between checks
+  size_t share = budget / 2 ? budget / 2 : 1;
+
+  // Basic checks need up to 4 calls per element
+  size_t len = share / 4;
+  len = len < 2 ? 2 : len > n ? n : len;
+  size_t start = segment_start(seed, n, len);
+  check_basic(&ctx, &c, 0, 0, (const char *)data + start * sz, len, sz);
+
+  // Axioms are checked on w * w pairs
+  size_t w, max_w = n < MAX_WINDOW ? n : MAX_WINDOW;
+  for(w = 2; w < max_w && (w + 1) * (w + 1) <= share; ++w)
+    ;
+  check_sample(&ctx, &c, seed_mix(seed, 1), data, n, sz, w);
+
+  return ctx.found_error;
+}
+
+EXPORT int sortcheck_verify_sorted(const void *data, size_t n, size_t sz, sortcheck_cmp_fun_t cmp, void *arg, size_t budget) {
+  ErrorContext ctx = { .func = __func__, .cmp_addr = cmp, .ret_addr = __builtin_return_address(0) };
+  Comparator c = { cmp, arg, 1 };
+
+  if(n < 2)
+    return 0;
+
+  size_t len = !budget || budget >= n ? n : budget + 1;
+  size_t start = len == n ? 0 : segment_start(next_seed(&ctx), n, len);
+  check_sorted(&ctx, &c, 0, (const char *)data + start * sz, len, sz);
+
+  return ctx.found_error;
+}
+
+EXPORT int sortcheck_verify_bsearch(const void *key, const void *data, size_t n, size_t sz, sortcheck_cmp_fun_t cmp, void *arg, size_t budget) {
+  ErrorContext ctx = { .func = __func__, .cmp_addr = cmp, .ret_addr = __builtin_return_address(0) };
+  Comparator c = { cmp, arg, 1 };
+
+  if(!n)
+    return 0;
+
+  if(!budget || budget >= 4 * n) {
+    check_basic(&ctx, &c, 0, key, data, n, sz);
+    check_total_order(&ctx, &c, 0, key, data, n, sz);
+    check_sorted(&ctx, &c, key, data, n, sz);
+  } else if(flags.checks & CHECK_SORTED) {
+    // Logarithmic number of calls
+    check_bsearch_path(&ctx, &c, key, data, n, sz);
+  }
+
+  return ctx.found_error;
+}
+
+// Checked versions of qsort and bsearch for link-time wrappers
+// (see wrap_qsort.c and wrap_bsearch.c)
+
+typedef void qsort_fun_t(void *data, size_t n, size_t sz, cmp_fun_t cmp);
+
+EXPORT void __sortcheck_qsort(void *data, size_t n, size_t sz, cmp_fun_t cmp, qsort_fun_t *real, const void *ret_addr);
+EXPORT void *__sortcheck_bsearch(const void *key, const void *data, size_t n, size_t sz, cmp_fun_t cmp, bsearch_fun_t *real, const void *ret_addr);
+
+EXPORT void __sortcheck_qsort(void *data, size_t n, size_t sz, cmp_fun_t cmp, qsort_fun_t *real, const void *ret_addr) {
+  if(!init_done)
+    init();
+  ErrorContext ctx = { .func = "qsort", .cmp_addr = cmp, .ret_addr = ret_addr };
+  CAPTURE_STACK(ctx);
+  Comparator c = { cmp, 0, 0 };
+  checked_sort(&ctx, &c, data, n, sz, 0, call_qsort, real);
+}
+
+EXPORT void *__sortcheck_bsearch(const void *key, const void *data, size_t n, size_t sz, cmp_fun_t cmp, bsearch_fun_t *real, const void *ret_addr) {
+  if(!init_done)
+    init();
+  ErrorContext ctx = { .func = "bsearch", .cmp_addr = cmp, .ret_addr = ret_addr };
+  CAPTURE_STACK(ctx);
+  return checked_bsearch(&ctx, key, data, n, sz, cmp, real);
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <backtrace.h>
+#include <perm.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <pthread.h>
+
+static __thread uintptr_t stack_lo, stack_hi;
+static __thread int stack_bounds_state;  // 0 - unknown, 1 - known, -1 - not available
+
+int get_stack_bounds(const void **lo, const void **hi) {
+  if(!stack_bounds_state) {
+    stack_bounds_state = -1;
+#ifdef __GLIBC__
+    pthread_attr_t attr;
+    if(0 == pthread_getattr_np(pthread_self(), &attr)) {
+      void *addr;
+      size_t size;
+      if(0 == pthread_attr_getstack(&attr, &addr, &size)) {
+        stack_lo = (uintptr_t)addr;
+        stack_hi = stack_lo + size;
+        stack_bounds_state = 1;
+      }
+      pthread_attr_destroy(&attr);
+    }
+#endif
+  }
+
+  if(stack_bounds_state < 0)
+    return 0;
+
+  *lo = (const void *)stack_lo;
+  *hi = (const void *)stack_hi;
+  return 1;
+}
+
+__attribute__((noinline))
+size_t get_backtrace(const void **frames, size_t max_depth) {
+  // Frame record is { saved frame pointer, return address }
+  // on all supported targets (x86, AArch64, etc.).
+  const uintptr_t *fp = __builtin_frame_address(0);
+
+  const void *lo, *hi;
+  size_t depth = 0;
+  if(!get_stack_bounds(&lo, &hi)) {
+    // Can't walk safely so settle with caller
+    if(max_depth)
+      frames[depth++] = __builtin_return_address(0);
+    return depth;
+  }
+
+  // Skip our own frame
+  fp = (const uintptr_t *)fp[0];
+
+  while(depth < max_depth) {
+    if((uintptr_t)fp < (uintptr_t)lo
+        || (uintptr_t)fp + 2 * sizeof(uintptr_t) > (uintptr_t)hi
+        || (uintptr_t)fp % sizeof(uintptr_t))
+      break;
+
+    uintptr_t ret = fp[1];
+    if(!ret)
+      break;
+    frames[depth++] = (const void *)ret;
+
+    // Stack grows down so callers' frames must be located higher
+    const uintptr_t *next = (const uintptr_t *)fp[0];
+    if(next <= fp)
+      break;
+    fp = next;
+  }
+
+  return depth;
+}
+
+unsigned hash_backtrace(const void *const *frames, size_t depth) {
+  unsigned h = 0;
+  size_t i;
+  for(i = 0; i < depth; ++i)
+    h = seed_mix(h, (uintptr_t)frames[i]);
+  return h ? h : 1;  // 0 is reserved for "no stack"
+}
+
+#define STACK_TABLE_SIZE 1024
+
+enum { SLOT_EMPTY, SLOT_BUSY, SLOT_READY };
+
+static Stack stack_table[STACK_TABLE_SIZE];
+static int stack_table_state[STACK_TABLE_SIZE];
+
+const Stack *intern_backtrace(const void *const *frames, size_t depth, unsigned hash) {
+  if(depth > MAX_BACKTRACE_DEPTH)
+    depth = MAX_BACKTRACE_DEPTH;
+
+  size_t i, probe;
+  for(i = hash % STACK_TABLE_SIZE, probe = 0; probe < STACK_TABLE_SIZE; i = (i + 1) % STACK_TABLE_SIZE, ++probe) {
+    int state = __atomic_load_n(&stack_table_state[i], __ATOMIC_ACQUIRE);
+
+    if(state == SLOT_EMPTY) {
+      if(!__atomic_compare_exchange_n(&stack_table_state[i], &state, SLOT_BUSY, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        if(state == SLOT_BUSY)
+          continue;  // Someone else is writing, try next slot
+      } else {
+        Stack *s = &stack_table[i];
+        s->hash = hash;
+        s->depth = (unsigned)depth;
+        memcpy(s->frames, frames, depth * sizeof(frames[0]));
+        __atomic_store_n(&stack_table_state[i], SLOT_READY, __ATOMIC_RELEASE);
+        return s;
+      }
+    }
+
+    if(state == SLOT_READY) {
+      const Stack *s = &stack_table[i];
+      if(s->hash == hash && s->depth == depth
+          && 0 == memcmp(s->frames, frames, depth * sizeof(frames[0])))
+        return s;
+    }
+  }
+
+  return NULL;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <bsearch_cache.h>
+#include <checksum.h>
+#include <perm.h>
+
+#include <stdint.h>
+
+#define CACHE_SIZE 1024  // Must be power of 2
+#define MAX_PROBES 4
+
+typedef struct {
+  const void *data;
+  size_t n, sz;
+  const void *cmp;
+  uint64_t fingerprint;
+  uint64_t tag;  // Detects entries torn by concurrent updates
+} CacheEntry;
+
+static CacheEntry cache[CACHE_SIZE];
+
+static inline uint64_t get_tag(const CacheEntry *e) {
+  uint64_t h = FNV1A_INIT;
+  h = fnv1a(h, &e->data, sizeof(e->data));
+  h = fnv1a(h, &e->n, sizeof(e->n));
+  h = fnv1a(h, &e->sz, sizeof(e->sz));
+  h = fnv1a(h, &e->cmp, sizeof(e->cmp));
+  h = fnv1a(h, &e->fingerprint, sizeof(e->fingerprint));
+  return h;
+}
+
+static inline size_t get_slot(const void *data, size_t n, const void *cmp) {
+  unsigned h = seed_mix(seed_mix(0, (uintptr_t)data), (uintptr_t)cmp ^ n);
+  return h & (CACHE_SIZE - 1);
+}
+
+int bsearch_cache_lookup(const void *data, size_t n, size_t sz, const void *cmp) {
+  size_t slot = get_slot(data, n, cmp), i;
+  for(i = 0; i < MAX_PROBES; ++i) {
+    CacheEntry e = cache[(slot + i) & (CACHE_SIZE - 1)];
+    if(e.data == data && e.n == n && e.sz == sz && e.cmp == cmp) {
+      // Racy but ok: torn entries are rejected via tag
+      return e.tag == get_tag(&e)
+             && e.fingerprint == fingerprint(data, n, sz);
+    }
+  }
+  return 0;
+}
+
+void bsearch_cache_insert(const void *data, size_t n, size_t sz, const void *cmp) {
+  size_t slot = get_slot(data, n, cmp), i;
+
+  // Reuse entry for same array or empty slot,
+  // otherwise evict first entry in chain
+  CacheEntry *victim = &cache[slot];
+  for(i = 0; i < MAX_PROBES; ++i) {
+    CacheEntry *e = &cache[(slot + i) & (CACHE_SIZE - 1)];
+    if(!e->data || (e->data == data && e->n == n && e->sz == sz && e->cmp == cmp)) {
+      victim = e;
+      break;
+    }
+  }
+
+  CacheEntry e = { data, n, sz, cmp, fingerprint(data, n, sz), 0 };
+  e.tag = get_tag(&e);
+  *victim = e;
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <callsite.h>
+#include <addr_table.h>
+
+#define CALLSITE_TABLE_SIZE 4096
+
+static Callsite callsite_table[CALLSITE_TABLE_SIZE];
+static int callsite_table_state[CALLSITE_TABLE_SIZE];
+
+static AddrTable callsites = ADDR_TABLE_INIT(callsite_table, callsite_table_state);
+
+Callsite *get_callsite(const void *ret_addr) {
+  return addr_table_get(&callsites, ret_addr);
+}
+
+Callsite *next_callsite(Callsite *prev) {
+  return addr_table_next(&callsites, prev);
+}
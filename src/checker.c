@@ -0,0 +1,1564 @@
+/*
+ * Copyright 2015-2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Checking engine (independent of interceptors)
+
+#include <checker.h>
+#include <backtrace.h>
+#include <checksum.h>
+#include <proc_info.h>
+#include <io.h>
+#include <platform.h>
+#include <pool.h>
+#include <protect.h>
+#include <callsite.h>
+#include <cmp_state.h>
+#include <dump.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <errno.h>
+#include <limits.h>
+#include <fnmatch.h>
+
+#ifdef __ELF__
+#include <link.h>  // ElfW
+#endif
+#include <syslog.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// Runtime options
+FILE *out;
+Flags flags = {
+  /*debug*/ 0,
+  /*report_error*/ 1,
+  /*print_to_syslog*/ 0,
+  /*raise*/ 0,
+  /*bsearch_cache*/ 0,
+  /*lsearch_cache*/ 0,
+  /*bsearch_path*/ 0,
+  /*protect*/ 0,
+  /*rotate*/ 0,
+  /*print_stats*/ 0,
+  /*incremental*/ 0,
+  /*tiered*/ 0,
+  /*perf*/ 0,
+  /*replace_sort*/ 0,
+  /*max_errors*/ 10,
+  /*sleep*/ 0,
+  /*checks*/ CHECK_DEFAULT,
+  /*start*/ 0,
+  /*shuffle*/ UINT_MAX,
+  /*backtrace*/ 0,
+  /*window*/ 32,
+  /*threads*/ 0,
+  /*escalate*/ 16,
+  /*sample*/ 0,
+  /*cmp_cost*/ 0,
+  /*lint*/ 0,
+  /*out_filename*/ 0,
+  /*dump_dir*/ 0,
+  /*trace_prefix*/ 0,
+  /*npolicies*/ 0,
+  /*policies*/ { { 0, 0, 0, 0, 0, 0 } }
+};
+
+typedef struct ProcMapNode_ {
+  ProcMap *maps;
+  size_t nmaps;
+  struct ProcMapNode_ *next;
+  int dlopen_gen;
+} ProcMapNode;
+
+// Other pieces of state
+volatile int init_in_progress = 0, init_done = 0;
+static ProcMapNode maps_first, *maps_head = &maps_first;
+int dlopen_gen = 1;  // Will cause calculation of mappings
+static char *proc_name, *proc_cmdline;
+static unsigned num_errors = 0;
+
+typedef struct {
+  const void *cmp;
+  unsigned stack_hash;
+} ReportedError;
+
+static ReportedError reported_errors[MAX_ERRORS];
+
+// USDT probes at start and end of each check
+// (end probe fires when scope is left).
+// Performance counters are also collected here (perf=1).
+// Dump input set by check is forgotten at scope end
+// because it may point to check's temporaries.
+typedef struct {
+  const char *name;
+  ErrorContext *ctx;
+  Stage stage;
+  PerfSample start;
+} CheckScope;
+
+static inline void check_scope_end(const CheckScope *s) {
+  PROBE2(check__end, s->name, s->ctx->found_error);
+  perf_end(s->ctx, s->stage, &s->start);
+  reset_dump_input(s->ctx);
+}
+
+#define CHECK_SCOPE(ctx, n, stage)                                       \
+  PROBE2(check__start, __func__, n);                                     \
+  CheckScope _scope __attribute__((cleanup(check_scope_end), unused)) = { __func__, ctx, stage, { { 0 } } }; \
+  perf_begin(&_scope.start)
+
+static void fini(void) {
+  // FIXME: do we really need to release this stuff?
+
+  ProcMapNode *maps_head_ = maps_head;
+  maps_head = &maps_first;
+  barrier();
+  for(; maps_head_ != &maps_first; ) {
+    ProcMapNode *old = maps_head_;
+    maps_head_ = maps_head_->next;
+    free(old->maps);
+    free(old);
+  }
+
+  if(proc_cmdline)
+    free(proc_cmdline);
+  if(proc_name)
+    free(proc_name);
+}
+
+static void print_stats(void);
+static void print_perf(void);
+static void print_cmp_cost(void);
+static void print_lint(void);
+
+static void update_maps() {
+  int gen = dlopen_gen;
+  barrier();
+
+  assert(gen >= maps_head->dlopen_gen);
+  if(gen == maps_head->dlopen_gen)
+    return;
+
+  ProcMapNode *new = malloc(sizeof(ProcMapNode));
+  new->maps = get_proc_maps(&new->nmaps);
+  new->next = maps_head;
+  new->dlopen_gen = gen;
+  maps_head = new;  // TODO: CAS?
+
+  PROBE2(maps__update, gen, new->nmaps);
+
+  if(flags.debug) {
+    fprintf(out, "Process map (gen %d):\n", new->dlopen_gen);
+    size_t i;
+    for(i = 0; i < new->nmaps; ++i) {
+      const ProcMap *m = &new->maps[i];
+      fprintf(out, "  %50s: %p-%p\n", &m->name[0], m->begin_addr, m->end_addr);
+    }
+  }
+}
+
+// Collect info needed for reporting
+// (called on first report)
+static void do_init_reporting(void) {
+  if(flags.print_to_syslog) {
+    openlog("", 0, LOG_USER);
+  } else if(flags.out_filename) {
+    FILE *f = fopen(flags.out_filename, "ab");
+    if(!f) {
+      fprintf(stderr, "sortcheck: failed to open %s for writing: errno %d: ", flags.out_filename, errno);
+      perror(0);
+      exit(1);
+    }
+    out = f;
+  } else if(!out) {
+    // init() was not called (e.g. when using public API)
+    out = stderr;
+  }
+
+  get_proc_cmdline(&proc_name, &proc_cmdline);
+
+  atexit(fini);
+}
+
+static void init_reporting(void) {
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  // Opening output may call intercepted functions (e.g. libcowdancer's fopen)
+  // and pthread_once would deadlock on recursion
+  static __thread int in_progress;
+  if(in_progress)
+    return;
+  in_progress = 1;
+  pthread_once(&once, do_init_reporting);
+  in_progress = 0;
+}
+
+void init(void) {
+  if(init_done)
+    return;
+
+  // TODO: proper atomics here
+  if(init_in_progress) {
+    // This is a workaround for recursive deadlock with libcowdancer:
+    // (gdb) bt
+    // #0  init () at src/sortchecker.c:105
+    // #1  0x00007f4c2bc125c4 in bsearch (key=0x7fff1b02d130, data=0x7f4c2c1e1010, n=20721, sz=16, cmp=0x7f4c2be177d0 <compare_ilist>)
+    //     at src/sortchecker.c:468
+    // #2  0x00007f4c2be16e42 in ?? () from /usr/lib/cowdancer/libcowdancer.so
+    // #3  0x00007f4c2be173e7 in fopen () from /usr/lib/cowdancer/libcowdancer.so
+    // #4  0x00007f4c2bc11806 in init () at src/sortchecker.c:197
+    // #5  0x00007f4c2bc129a0 in qsort (data=0x6f0e20 <static_shell_builtins>, n=76, sz=48, cmp=0x4746a0) at src/sortchecker.c:502
+    // #6  0x0000000000420c9e in ?? ()
+    // #7  0x000000000041f2cd in main ()
+    //
+    // FIXME: we should be able to detect recursion
+#if 0
+    while(!init_done)
+      barrier();
+    // TODO: sleep?
+#endif
+
+    return;
+  }
+
+  init_in_progress = 1;
+  barrier();
+
+  // When preloaded to whole distro, init is run in every process
+  // so it should be as cheap as possible. Only options are parsed here,
+  // the rest is done lazily when first error is reported.
+
+  // Options are kept in static buffers to avoid mallocs
+  static char file_opts[4096], env_opts[4096];
+
+  size_t file_len = read_file_to_buf("/SORTCHECK_OPTIONS", file_opts, sizeof(file_opts));
+  if(file_len >= sizeof(file_opts) - 1) {
+    fprintf(stderr, "sortcheck: /SORTCHECK_OPTIONS is too long\n");
+    exit(1);
+  }
+  if(file_len) {
+    if(!parse_flags(file_opts, &flags))
+      exit(1);
+  }
+
+  const char *opts;
+  if((opts = getenv("SORTCHECK_OPTIONS"))) {
+    if(strlen(opts) >= sizeof(env_opts)) {
+      fprintf(stderr, "sortcheck: SORTCHECK_OPTIONS is too long\n");
+      exit(1);
+    }
+    strcpy(env_opts, opts);
+    if(!parse_flags(env_opts, &flags))
+      exit(1);
+  }
+
+  if(flags.print_to_syslog && flags.out_filename) {
+    fprintf(stderr, "sortcheck: both print_to_syslog and print_to_file were specified\n");
+    exit(1);
+  }
+
+  if(!flags.print_to_syslog)
+    out = stderr;
+
+  dlopen_gen = 1; // Will cause recalculation of mappings
+
+  // TODO: proper atomics here
+  barrier();
+  init_done = 1;
+  init_in_progress = 0;
+
+  // Debug output may be printed anywhere
+  // so be conservative
+  if(flags.debug)
+    init_reporting();
+
+  if(flags.print_stats) {
+    // Reporting should be initialized before so that
+    // its atexit handler runs after print_stats
+    init_reporting();
+    atexit(print_stats);
+  }
+
+  if(flags.perf) {
+    init_reporting();
+    atexit(print_perf);
+  }
+
+  if(flags.cmp_cost) {
+    init_reporting();
+    atexit(print_cmp_cost);
+  }
+
+  if(flags.lint) {
+    init_reporting();
+    atexit(print_lint);
+  }
+}
+
+// Is module position-independent (i.e. shared library or PIE)?
+static int is_dyn_module(const ProcMap *map) {
+#ifdef __ELF__
+  if(map->readable) {
+    const ElfW(Ehdr) *ehdr = map->begin_addr;
+    if(0 == memcmp(ehdr->e_ident, ELFMAG, SELFMAG))
+      return ehdr->e_type == ET_DYN;
+  }
+#endif
+  return strstr(&map->name[0], ".so") != 0;
+}
+
+static void addr_to_module(const void *addr, const char **module, size_t *offset) {
+  const ProcMap *map = find_proc_map_for_addr(maps_head->maps, maps_head->nmaps, addr);
+  if(map) {
+    *module = &map->name[0];
+    *offset = (size_t)addr;
+    if(is_dyn_module(map))
+      *offset -= (size_t)map->begin_addr;
+  } else {
+    *module = "<unknown>";
+    *offset = 0;
+  }
+}
+
+void get_module_offsets(const void *const *addrs, size_t naddrs, const char **modules, size_t *offsets) {
+  update_maps();
+  size_t i;
+  for(i = 0; i < naddrs; ++i)
+    addr_to_module(addrs[i], &modules[i], &offsets[i]);
+}
+
+// Print symbolized backtrace (caller's frame is skipped
+// as it's reported separately)
+static void format_backtrace(char *buf, size_t size, const Stack *stack) {
+  size_t i, len = 0;
+  buf[0] = 0;
+  for(i = 1; stack && i < stack->depth && len < size; ++i) {
+    const char *module;
+    size_t offset;
+    addr_to_module(stack->frames[i], &module, &offset);
+    len += snprintf(buf + len, size - len, "%s%p (%s+0x%zx)", i > 1 ? ", " : "", stack->frames[i], module, offset);
+  }
+}
+
+static void resolve_modules(ErrorContext *ctx) {
+  if(!ctx->cmp_module) {
+    // Lazily compute modules (no race!)
+
+    update_maps();
+
+    addr_to_module(ctx->cmp_addr, &ctx->cmp_module, &ctx->cmp_offset);
+    addr_to_module(ctx->ret_addr, &ctx->caller_module, &ctx->caller_offset);
+  }
+}
+
+// Save input of failed check for offline analysis (dump_dir)
+static void dump_error(ErrorContext *ctx, const char *msg) {
+  if(!ctx->dump_data || !ctx->dump_n)
+    return;
+
+  resolve_modules(ctx);
+
+  // Key can be dumped only if it has the same type as elements
+  const char *key = ctx->dump_key && (get_checks(ctx) & CHECK_GOOD_BSEARCH) ? ctx->dump_key : 0;
+
+  DumpHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.orig_n = ctx->dump_n;
+  hdr.n = ctx->dump_n;
+  hdr.sz = ctx->dump_sz;
+  if(hdr.n > DUMP_MAX_ELEMS)
+    hdr.n = DUMP_MAX_ELEMS;
+  if(hdr.n * hdr.sz > DUMP_MAX_BYTES)
+    hdr.n = DUMP_MAX_BYTES / hdr.sz;
+  hdr.is_reentrant = ctx->dump_reentrant;
+  hdr.cmp_offset = ctx->cmp_offset;
+  hdr.caller_offset = ctx->caller_offset;
+  hdr.seed = flags.shuffle;
+
+  const char *opts = getenv("SORTCHECK_OPTIONS");
+  char fname[PATH_MAX];
+  if(!write_dump(flags.dump_dir, &hdr, ctx->func, ctx->cmp_module, opts ? opts : "", msg, ctx->dump_data, ctx->dump_idx, key, fname, sizeof(fname))) {
+    if(flags.debug)
+      fprintf(out ? out : stderr, "sortcheck: failed to write dump to %s (errno %d)\n", flags.dump_dir, errno);
+  } else if(flags.debug)
+    fprintf(out ? out : stderr, "sortcheck: saved dump to %s\n", fname);
+}
+
+void report_error(ErrorContext *ctx, const char *fmt, ...) {
+  PROBE4(violation, ctx->func, fmt, ctx->cmp_addr, ctx->ret_addr);
+
+  va_list ap;
+  va_start(ap, fmt);
+  char body[128];
+  vsnprintf(body, sizeof(body), fmt, ap);
+  va_end(ap);
+
+  // Errors are dumped even if they are not reported
+  if(flags.dump_dir)
+    dump_error(ctx, body);
+
+  // Racy but ok
+  size_t i;
+  for(i = 0; i < flags.max_errors; ++i) {
+    if (!reported_errors[i].cmp) {
+      reported_errors[i].cmp = ctx->cmp_addr;
+      reported_errors[i].stack_hash = ctx->stack_hash;
+      break;
+    }
+  }
+  if(i == flags.max_errors)
+    return;
+
+  // Increment global counter on first error in current invocation
+  if(!ctx->found_error) {
+    ctx->found_error = 1;
+    ++num_errors;
+  }
+
+  if(!flags.report_error)
+    return;
+
+  init_reporting();
+
+  resolve_modules(ctx);
+
+  // Symbolization of full stack is delayed until now
+  char bt[1024] = "";
+  if(ctx->depth > 1) {
+    const Stack *stack = intern_backtrace(ctx->frames, ctx->depth, ctx->stack_hash);
+    format_backtrace(bt, sizeof(bt), stack);
+  }
+
+  char buf[256];
+
+  char *full_msg = buf;
+  size_t full_msg_size = sizeof(buf);
+  for(i = 0; i < 2; ++i) {
+    // TODO: some parts of the message may be precomputed
+    size_t need = snprintf(full_msg, full_msg_size, "%s[%ld]: %s: %s (comparison function %p (%s+0x%zx), called from %p (%s+0x%zx)%s%s, cmdline is \"%s\")\n", proc_name, (long)getpid(), ctx->func, body, ctx->cmp_addr, ctx->cmp_module, ctx->cmp_offset, ctx->ret_addr, ctx->caller_module, ctx->caller_offset, bt[0] ? ", backtrace " : "", bt, proc_cmdline ? proc_cmdline : "");
+    if(i == 0 && need < sizeof(body))  // Did it fit to local buf?
+      break;
+    if(i == 0 && need >= sizeof(body)) {  // It didn't - go ahead and malloc
+      full_msg_size = need + 1;
+      full_msg = malloc(full_msg_size);
+    }
+  }
+
+  // TODO: factor out generic printing
+  if(!out)
+    syslog(LOG_WARNING, "%s", full_msg);
+  else {
+    fputs(full_msg, out);
+    fflush(out);
+  }
+
+  if(full_msg != buf)
+    free(full_msg);
+
+  if(flags.sleep)
+    sleep(flags.sleep);
+
+  if(flags.raise)
+    raise(SIGTRAP);
+}
+
+// Select pseudo-random order in which elements are checked
+// in current invocation (user data is never modified).
+// Seed depends on thread and callsite so that threads
+// which start at the same time check different elements.
+const Perm *get_perm(Perm *p, const ErrorContext *ctx, size_t n) {
+  static __thread unsigned ncalls, thread_seed;
+  if(flags.shuffle == UINT_MAX)
+    return 0;
+  if(!ncalls)
+    thread_seed = seed_mix(flags.shuffle, (unsigned)get_thread_id());
+  // Page offset of return address does not depend on ASLR
+  unsigned seed = seed_mix(thread_seed, (uintptr_t)ctx->ret_addr & 0xfff);
+  perm_init(p, n, seed_mix(seed, ncalls++));
+  return p;
+}
+
+static inline size_t elem_index(const Perm *perm, size_t i) {
+  return perm ? perm_apply(perm, i) : i;
+}
+
+// Index of i-th element of stratified sample of k elements
+// out of n (one random element from each of k equal strata)
+static inline size_t sample_index(size_t i, size_t k, size_t n, unsigned seed) {
+  size_t lo = i * n / k, hi = (i + 1) * n / k;
+  return lo + seed_mix(seed, i) % (hi - lo);
+}
+
+// Record sampling in callsite statistics (sample=K)
+static void note_sampled(const ErrorContext *ctx, size_t n) {
+  Callsite *cs = ctx->callsite;
+  if(!cs)
+    return;
+  __atomic_fetch_add(&cs->nsampled, 1, __ATOMIC_RELAXED);
+  size_t old = __atomic_load_n(&cs->max_sampled_n, __ATOMIC_RELAXED);
+  while(n > old && !__atomic_compare_exchange_n(&cs->max_sampled_n, &old, n, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+typedef struct {
+  const Comparator *cmp;
+  const char *key;
+  const void *data;
+  size_t sz;
+  size_t test_idx;
+  size_t nsample, n;  // Check stratified sample of nsample out of n elements (if non-zero)
+  unsigned seed;
+  const char *test_val;
+  unsigned cs_test_val;
+  int check_self;
+  const char *prot_begin, *prot_end;
+  size_t modified_at, unstable_at;  // Array indices of first detected errors
+} BasicTask;
+
+static inline void atomic_min(size_t *p, size_t val) {
+  size_t old = __atomic_load_n(p, __ATOMIC_RELAXED);
+  while(val < old && !__atomic_compare_exchange_n(p, &old, val, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+static void check_basic_range(void *arg, size_t begin, size_t end) {
+  BasicTask *t = arg;
+  const Comparator *cmp = t->cmp;
+  const char *key = t->key, *test_val = t->test_val;
+  size_t sz = t->sz;
+  size_t i;
+
+  // Check for modifying comparison functions
+  for(i = begin; i < end; ++i) {
+    size_t j = t->nsample ? sample_index(i, t->nsample, t->n, t->seed) : i;
+    if(!key && j == t->test_idx)
+      continue;  // Avoid self-comparison
+    const char *val = (const char *)t->data + j * sz;
+    if(t->prot_begin <= val && val + sz <= t->prot_end) {
+      // Writes will be detected via page protection
+      cmp_eval(cmp, test_val, val);
+      if(t->check_self)
+        cmp_eval(cmp, val, val);
+      continue;
+    }
+
+    unsigned cs = checksum(val, sz);
+    cmp_eval(cmp, test_val, val);
+    if(cs != checksum(val, sz)
+        || (!key && t->cs_test_val != checksum(test_val, sz))) {
+      atomic_min(&t->modified_at, j);
+      break;
+    }
+
+    if(t->check_self) {
+      cmp_eval(cmp, val, val);
+      if(cs != checksum(val, sz)) {
+        atomic_min(&t->modified_at, j);
+        break;
+      }
+    }
+  }
+
+  // Check for non-constant return value
+  for(i = begin; i < end; ++i) {
+    size_t j = t->nsample ? sample_index(i, t->nsample, t->n, t->seed) : i;
+    if(!key && j == t->test_idx)
+      continue;
+    const void *val = (const char *)t->data + j * sz;
+    if(cmp_eval(cmp, test_val, val) != cmp_eval(cmp, test_val, val)
+        || (t->check_self && cmp_eval(cmp, val, val) != cmp_eval(cmp, val, val))) {
+      atomic_min(&t->unstable_at, j);
+      break;
+    }
+  }
+}
+
+// Check that comparator is stable and does not modify arguments
+void check_basic(ErrorContext *ctx, const Comparator *cmp, const Perm *perm, const char *key, const void *data, size_t n, size_t sz) {
+  unsigned checks = get_checks(ctx);
+  if(!(checks & CHECK_BASIC))
+    return;
+  CHECK_SCOPE(ctx, n, STAGE_BASIC);
+  set_dump_input(ctx, cmp, key, data, 0, n, sz);
+
+  BasicTask t;
+  t.cmp = cmp;
+  t.key = key;
+  t.sz = sz;
+  t.test_idx = elem_index(perm, 0);
+  t.test_val = key ? key : (const char *)data + t.test_idx * sz;
+  t.cs_test_val = key ? 0 : checksum(t.test_val, sz);
+  t.check_self = (checks & CHECK_REFLEXIVITY)
+                 && (!key || (checks & CHECK_GOOD_BSEARCH));
+  t.prot_begin = ctx->prot_begin;
+  t.prot_end = ctx->prot_end;
+  t.modified_at = t.unstable_at = SIZE_MAX;
+
+  // With sampling only check random subset of elements
+  // (stratified so that whole array is covered evenly)
+  static __thread unsigned nsampled;
+  t.nsample = t.n = 0;
+  if(flags.sample && flags.sample < n) {
+    t.nsample = flags.sample;
+    t.n = n;
+    t.seed = seed_mix((unsigned)(uintptr_t)ctx->ret_addr, nsampled++);
+    note_sampled(ctx, n);
+  }
+
+  // With limited budget only check random segment
+  // (up to 4 comparisons per element)
+  size_t begin = 0, budget = get_budget(ctx);
+  if(t.nsample) {
+    n = t.nsample;
+  } else if(budget && budget / 4 < n) {
+    static __thread unsigned ncalls;
+    size_t len = budget / 4 ? budget / 4 : 1;
+    begin = seed_mix((unsigned)(uintptr_t)ctx->ret_addr, ncalls++) % (n - len + 1);
+    n = len;
+  }
+  t.data = (const char *)data + begin * sz;
+  t.test_idx = t.test_idx - begin;  // Wraps around if test element is outside of segment
+
+  pool_run(flags.threads, check_basic_range, &t, n, 64);
+
+  if(t.modified_at != SIZE_MAX)
+    report_error(ctx, "comparison function modifies data");
+  if(t.unstable_at != SIZE_MAX)
+    report_error(ctx, "comparison function returns unstable results");
+}
+
+void check_uniqueness(ErrorContext *ctx, const Comparator *cmp, const void *data, size_t n, size_t sz) {
+  if(!(get_checks(ctx) & CHECK_UNIQUE))
+    return;
+  CHECK_SCOPE(ctx, n, STAGE_UNIQUE);
+  set_dump_input(ctx, cmp, 0, data, 0, n, sz);
+
+  // With sampling only check stratified sample of adjacent pairs
+  static __thread unsigned nsampled;
+  size_t npairs = n ? n - 1 : 0, nchecked = npairs;
+  unsigned seed = 0;
+  if(flags.sample && flags.sample < npairs) {
+    nchecked = flags.sample;
+    seed = seed_mix((unsigned)(uintptr_t)ctx->ret_addr, nsampled++);
+    note_sampled(ctx, npairs);
+  }
+
+  size_t k;
+  for(k = 0; k < nchecked; ++k) {
+    size_t i = 1 + (nchecked < npairs ? sample_index(k, nchecked, npairs, seed) : k);
+    const void *val = (const char *)data + i*sz;
+    const void *prev = (const char *)val - sz;
+    if(!cmp_eval(cmp, val, prev) && 0 != memcmp(prev, val, sz)) {
+      report_error(ctx, "comparison function compares different objects as equal at index %zd", i);
+      return;  // Stop further reporting
+    }
+  }
+}
+
+// Check that array is sorted
+void check_sorted(ErrorContext *ctx, const Comparator *cmp, const char *key, const void *data, size_t n, size_t sz) {
+  unsigned checks = get_checks(ctx);
+  if(!(checks & CHECK_SORTED))
+    return;
+  CHECK_SCOPE(ctx, n, STAGE_SORTED);
+  set_dump_input(ctx, cmp, key, data, 0, n, sz);
+
+  if(key) {
+    int order = 1;
+    size_t i;
+    for(i = 0; i < n; ++i) {
+      const void *val = (const char *)data + i * sz;
+      int new_order = sign(cmp_eval(cmp, key, val));
+      if(new_order > order) {
+        report_error(ctx, "processed array is not sorted at index %zd", i);
+        return;  // Return to stop further error reporting
+      }
+      order = new_order;
+    }
+  }
+
+  if(!key || (checks & CHECK_GOOD_BSEARCH)) {
+    size_t i;
+    for(i = 1; i < n; ++i) {
+      const void *val = (const char *)data + i * sz;
+      const void *prev = (const char *)val - sz;
+      if(cmp_eval(cmp, prev, val) > 0) {
+        report_error(ctx, "processed array is not sorted at index %zd", i);
+        break;
+      }
+    }
+  }
+}
+
+#define MAX_PROBES 128
+
+typedef struct {
+  size_t idx;
+  int res;
+} Probe;
+
+// Compare key against element and check that result is stable
+// and element is not modified
+static int probe(ErrorContext *ctx, const Comparator *cmp, const char *key, const void *data, size_t i, size_t sz, Probe *probes, size_t *nprobes) {
+  const void *val = (const char *)data + i * sz;
+  int do_basic = (get_checks(ctx) & CHECK_BASIC) && !ctx->found_error;
+  unsigned cs = do_basic ? checksum(val, sz) : 0;
+  int res = sign(cmp_eval(cmp, key, val));
+  if(do_basic) {
+    if(cs != checksum(val, sz))
+      report_error(ctx, "comparison function modifies data");
+    else if(res != sign(cmp_eval(cmp, key, val)))
+      report_error(ctx, "comparison function returns unstable results");
+  }
+  if(*nprobes < MAX_PROBES) {
+    probes[*nprobes].idx = i;
+    probes[*nprobes].res = res;
+    ++*nprobes;
+  } else {
+    static int warned;
+    if(!__atomic_exchange_n(&warned, 1, __ATOMIC_RELAXED))
+      fprintf(out ? out : stderr, "sortcheck: more than %d bsearch probes, extra ones are not checked for sortedness\n", MAX_PROBES);
+  }
+  return res;
+}
+
+// Check sortedness of bsearch array in O(log n) comparisons:
+// replay binary search and verify that comparisons with key
+// on its path (plus neighbours of final position and
+// random elements in gaps between probes) are consistent
+// with sorted array.
+void check_bsearch_path(ErrorContext *ctx, const Comparator *cmp, const char *key, const void *data, size_t n, size_t sz) {
+  CHECK_SCOPE(ctx, n, STAGE_BSEARCH_PATH);
+  set_dump_input(ctx, cmp, key, data, 0, n, sz);
+  static __thread unsigned ncalls;
+
+  Probe probes[MAX_PROBES];
+  size_t nprobes = 0;
+
+  // Replay binary search
+  size_t lo = 0, hi = n, pos = n;
+  while(lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int res = probe(ctx, cmp, key, data, mid, sz, probes, &nprobes);
+    if(res == 0) {
+      pos = mid;
+      break;
+    }
+    if(res < 0)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  if(pos == n)
+    pos = lo;
+
+  // Neighbours of final position
+  if(pos > 0)
+    probe(ctx, cmp, key, data, pos - 1, sz, probes, &nprobes);
+  if(pos + 1 < n)
+    probe(ctx, cmp, key, data, pos + 1, sz, probes, &nprobes);
+
+  // Sort probes by index (insertion sort is fine for log n elements)
+  size_t i, j;
+  for(i = 1; i < nprobes; ++i) {
+    Probe p = probes[i];
+    for(j = i; j > 0 && probes[j - 1].idx > p.idx; --j)
+      probes[j] = probes[j - 1];
+    probes[j] = p;
+  }
+
+  // Spot checks in gaps between probes (including array ends)
+  unsigned seed = seed_mix((unsigned)(uintptr_t)ctx->ret_addr, ncalls++);
+  size_t nprobes_path = nprobes;
+  for(i = 0; i <= nprobes_path; ++i) {
+    size_t gap_begin = i ? probes[i - 1].idx + 1 : 0;
+    size_t gap_end = i < nprobes_path ? probes[i].idx : n;
+    if(gap_begin >= gap_end)
+      continue;
+    seed = seed_mix(seed, i);
+    size_t spot = gap_begin + seed % (gap_end - gap_begin);
+    probe(ctx, cmp, key, data, spot, sz, probes, &nprobes);
+  }
+
+  // Merge spot checks in
+  for(i = nprobes_path; i < nprobes; ++i) {
+    Probe p = probes[i];
+    for(j = i; j > 0 && probes[j - 1].idx > p.idx; --j)
+      probes[j] = probes[j - 1];
+    probes[j] = p;
+  }
+
+  // For sorted array cmp(key, x) is non-increasing
+  for(i = 1; i < nprobes; ++i) {
+    if(probes[i].res > probes[i - 1].res) {
+      report_error(ctx, "processed array is not sorted at index %zd", probes[i].idx);
+      return;
+    }
+  }
+
+  // Elements on path must be ordered
+  if(get_checks(ctx) & CHECK_GOOD_BSEARCH) {
+    for(i = 1; i < nprobes; ++i) {
+      const void *prev = (const char *)data + probes[i - 1].idx * sz;
+      const void *val = (const char *)data + probes[i].idx * sz;
+      if(probes[i - 1].idx != probes[i].idx && cmp_eval(cmp, prev, val) > 0) {
+        report_error(ctx, "processed array is not sorted at index %zd", probes[i].idx);
+        return;
+      }
+    }
+  }
+}
+
+typedef struct {
+  const Comparator *cmp;
+  const void *data;
+  size_t sz;
+  const size_t *idx;
+  size_t n;
+  unsigned checks;
+  int8_t *matrix;
+} MatrixTask;
+
+// Compare all pairs of elements in given rows of window
+static void eval_matrix_rows(void *arg, size_t begin, size_t end) {
+  MatrixTask *t = arg;
+  size_t i, j;
+  for(i = begin; i < end; ++i)
+  for(j = 0; j < t->n; ++j) {
+    const void *a = (const char *)t->data + t->idx[i] * t->sz;
+    const void *b = (const char *)t->data + t->idx[j] * t->sz;
+    if(i == j && !(t->checks & CHECK_REFLEXIVITY)) {
+      // Do not call cmp(x,x) unless explicitly asked by user
+      // because some projects assert on self-comparisons (e.g. GCC)
+      t->matrix[i * t->n + j] = 0;
+      continue;
+    }
+    t->matrix[i * t->n + j] = sign(cmp_eval(t->cmp, a, b));
+  }
+}
+
+// Check ordering axioms for elements with given indices
+void check_window(ErrorContext *ctx, const Comparator *cmp, const void *data, size_t sz, const size_t *idx, size_t n) {
+  CHECK_SCOPE(ctx, n, STAGE_WINDOW);
+  set_dump_input(ctx, cmp, 0, data, idx, n, sz);
+  // TODO: 2 bits enough for status
+  int8_t matrix_buf[32 * 32];
+  int8_t *matrix = matrix_buf;
+  if(n > 32) {
+    // Window is limited by options but be careful anyway
+    matrix = n <= SIZE_MAX / n ? malloc(n * n) : NULL;
+    if(!matrix) {
+      if(flags.debug)
+        fprintf(out, "sortcheck: failed to allocate matrix for window of %zu elements\n", n);
+      return;
+    }
+  }
+
+  unsigned checks = get_checks(ctx);
+  MatrixTask t = { cmp, data, sz, idx, n, checks, matrix };
+  pool_run(flags.threads, eval_matrix_rows, &t, n, 1);
+
+#define cmp_(i, j) matrix[(i) * n + (j)]
+
+  size_t i, j, k;
+
+  // Following axioms from http://mathworld.wolfram.com/StrictOrder.html
+
+  // Totality by construction
+
+  if(checks & CHECK_REFLEXIVITY) {
+    for(i = 0; i < n; ++i) {
+      // TODO: it may make sense to compare different but equal elements?
+      if(0 != cmp_(i, i)) {
+        report_error(ctx, "comparison function is not reflexive (returns non-zero for equal elements)");
+        break;
+      }
+    }
+  }
+
+  if(checks & CHECK_SYMMETRY) {
+    for(i = 0; i < n; ++i)
+    for(j = 0; j < i; ++j) {
+      if(cmp_(i, j) != -cmp_(j, i)) {
+        report_error(ctx, "comparison function is not symmetric");
+        goto sym_check_done;
+      }
+    }
+  }
+sym_check_done:
+
+  if(checks & CHECK_TRANSITIVITY) {
+    // FIXME: slow slow...
+    for(i = 0; i < n; ++i)
+    for(j = 0; j < i; ++j)
+    for(k = 0; k < n; ++k) {
+      // Don't compare element to itself unless requested by user
+      if((i == k || j == k) && !(checks & CHECK_REFLEXIVITY))
+        continue;
+      if(cmp_(i, j) == cmp_(j, k) && cmp_(i, j) != cmp_(i, k)) {
+        report_error(ctx, "comparison function is not transitive");
+        goto trans_check_done;
+      }
+    }
+  }
+trans_check_done:
+
+#undef cmp_
+
+  if(matrix != matrix_buf)
+    free(matrix);
+}
+
+static size_t gcd(size_t a, size_t b) {
+  while(b) {
+    size_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+// Select next window for callsite (for start=rotate).
+// Windows are visited with stride which is co-prime with their number
+// so all of them are covered in nwindows calls (if size does not change).
+static size_t rotate_window(Callsite *cs, size_t n, size_t window) {
+  size_t nwindows = (n + window - 1) / window;
+  size_t last_n = __atomic_load_n(&cs->last_n, __ATOMIC_RELAXED);
+  // Only one of concurrent callers restarts rotation
+  if(last_n != n && __atomic_compare_exchange_n(&cs->last_n, &last_n, n, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    __atomic_store_n(&cs->nwindows, nwindows, __ATOMIC_RELAXED);
+    __atomic_store_n(&cs->cursor, 0, __ATOMIC_RELAXED);
+  }
+  size_t k = __atomic_fetch_add(&cs->cursor, 1, __ATOMIC_RELAXED);
+
+  // Large stride so that consecutive windows are far apart
+  size_t stride = nwindows * 5 / 8 + 1;
+  while(gcd(stride, nwindows) != 1)
+    ++stride;
+
+  size_t start = (k % nwindows) * stride % nwindows * window;
+  // Last window may be incomplete
+  return start + window > n && n > window ? n - window : start;
+}
+
+// Check that ordering is total
+void check_total_order(ErrorContext *ctx, const Comparator *cmp, const Perm *perm, const char *key, const void *data, size_t n, size_t sz) {
+  // Can check only good bsearch callbacks
+  if(key && !(get_checks(ctx) & CHECK_GOOD_BSEARCH))
+    return;
+  CHECK_SCOPE(ctx, n, STAGE_TOTAL_ORDER);
+
+  size_t window = get_window(ctx);
+
+  size_t idx_buf[32];
+  size_t *idx = window <= 32 ? idx_buf : malloc(window * sizeof(size_t));
+  if(!idx)
+    return;
+
+  size_t start = flags.rotate && ctx->callsite
+    ? rotate_window(ctx->callsite, n, window)
+    : flags.start % n;
+  size_t len = n - start < window ? n - start : window;
+
+  // Window is never empty (start < n and window > 0)
+  size_t i = 0;
+  do
+    idx[i] = elem_index(perm, start + i);
+  while(++i < len);
+
+  check_window(ctx, cmp, data, sz, idx, len);
+
+  if(idx != idx_buf)
+    free(idx);
+}
+
+static inline size_t sorted_block_size(size_t n) {
+  return (n + SORTED_BLOCKS - 1) / SORTED_BLOCKS;
+}
+
+// Return length of unchanged prefix of array which was sorted
+// by previous call from same callsite (for incremental=1).
+// Prefix is found by comparing block checksums so it costs
+// no comparator calls.
+static size_t find_sorted_prefix(const ErrorContext *ctx, const Comparator *cmp, const void *data, size_t n, size_t sz) {
+  const Callsite *cs = ctx->callsite;
+  if(!cs || cs->sorted_data != data || cs->sorted_sz != sz
+      || cs->sorted_cmp != cmp->cmp || cs->sorted_arg != cmp->arg)
+    return 0;
+
+  size_t old_n = cs->sorted_n, bs = sorted_block_size(old_n);
+  size_t prefix = 0, k;
+  for(k = 0; prefix < old_n; ++k) {
+    size_t len = old_n - prefix < bs ? old_n - prefix : bs;
+    if(prefix + len > n
+        || checksum((const char *)data + prefix * sz, len * sz) != cs->sorted_cs[k])
+      break;
+    prefix += len;
+  }
+  return prefix;
+}
+
+// Remember fingerprint of sorted array for next call from same callsite
+static void remember_sorted(const ErrorContext *ctx, const Comparator *cmp, const void *data, size_t n, size_t sz) {
+  Callsite *cs = ctx->callsite;
+  if(!cs)
+    return;
+
+  unsigned cs_buf[SORTED_BLOCKS];
+  size_t bs = sorted_block_size(n);
+  size_t begin, k;
+  for(begin = k = 0; begin < n; begin += bs, ++k) {
+    size_t len = n - begin < bs ? n - begin : bs;
+    cs_buf[k] = checksum((const char *)data + begin * sz, len * sz);
+  }
+
+  // Racy but ok (torn state will most likely cause checksum mismatch
+  // and fallback to full checking)
+  cs->sorted_n = 0;
+  barrier();
+  memcpy(cs->sorted_cs, cs_buf, k * sizeof(unsigned));
+  cs->sorted_data = data;
+  cs->sorted_cmp = cmp->cmp;
+  cs->sorted_arg = cmp->arg;
+  cs->sorted_sz = sz;
+  barrier();
+  cs->sorted_n = n;
+}
+
+// Select cnt elements from range, one from each of cnt equal strata
+static void sample_range(size_t *idx, size_t cnt, size_t begin, size_t len, unsigned seed) {
+  size_t i;
+  for(i = 0; i < cnt; ++i)
+    idx[i] = begin + sample_index(i, cnt, len, seed);
+}
+
+// Check ordering axioms for elements appended to array after
+// its first old_n elements have been checked: new elements are checked
+// against each other and against a sample of old ones
+// so cost depends on size of change rather than size of array.
+void check_total_order_tail(ErrorContext *ctx, const Comparator *cmp, const void *data, size_t old_n, size_t n, size_t sz) {
+  CHECK_SCOPE(ctx, n, STAGE_TOTAL_ORDER);
+  static __thread unsigned ncalls;
+
+  // Half of window is reserved for new elements,
+  // the rest is filled with old ones
+  size_t nnew = n - old_n;
+  size_t window = get_window(ctx);
+  size_t take_new = nnew < (window + 1) / 2 ? nnew : (window + 1) / 2;
+  size_t take_old = old_n < window - take_new ? old_n : window - take_new;
+
+  size_t idx_buf[32];
+  size_t *idx = window <= 32 ? idx_buf : malloc(window * sizeof(size_t));
+  if(!idx)
+    return;
+
+  unsigned seed = seed_mix((unsigned)(uintptr_t)ctx->ret_addr, ncalls++);
+  sample_range(idx, take_new, old_n, nnew, seed);
+  sample_range(idx + take_new, take_old, 0, old_n, seed_mix(seed, 1));
+
+  check_window(ctx, cmp, data, sz, idx, take_new + take_old);
+
+  if(idx != idx_buf)
+    free(idx);
+}
+
+// Check array whose first old_n elements are unchanged since they
+// were sorted (and checked) in previous call
+static void check_incremental(ErrorContext *ctx, const Comparator *cmp, const void *data, size_t old_n, size_t n, size_t sz) {
+  if(n > old_n)
+    check_basic(ctx, cmp, 0, 0, (const char *)data + old_n * sz, n - old_n, sz);
+  check_total_order_tail(ctx, cmp, data, old_n, n, sz);
+}
+
+#define NUM_TIER0_PROBES 8
+
+// Cheap checks which are always done in tiered mode:
+// compare a few random pairs of elements in both orders.
+// Returns non-zero if comparator looks suspicious.
+// Ties are only suspicious for small scalars which are usually
+// compared as a whole (larger elements are often compared by key
+// or contain padding).
+static int check_tier0(ErrorContext *ctx, const Comparator *cmp, const void *data, size_t n, size_t sz) {
+  CHECK_SCOPE(ctx, n, STAGE_TIER0);
+  set_dump_input(ctx, cmp, 0, data, 0, n, sz);
+  static __thread unsigned ncalls;
+
+  if(n < 2)
+    return 0;
+
+  unsigned seed = seed_mix((unsigned)(uintptr_t)ctx->ret_addr, ncalls++);
+  int anomaly = 0;
+  size_t k;
+  for(k = 0; k < NUM_TIER0_PROBES; ++k) {
+    seed = seed_mix(seed, k);
+    size_t i = seed % n;
+    size_t j = (i + 1 + seed_mix(seed, 1) % (n - 1)) % n;  // Never equal to i
+    const void *a = (const char *)data + i * sz;
+    const void *b = (const char *)data + j * sz;
+    int ab = sign(cmp_eval(cmp, a, b));
+    int ba = sign(cmp_eval(cmp, b, a));
+    if(ab != sign(cmp_eval(cmp, a, b))) {
+      report_error(ctx, "comparison function returns unstable results");
+      return 1;
+    }
+    if(ab != -ba) {
+      report_error(ctx, "comparison function is not symmetric");
+      return 1;
+    }
+    // Not an error but worth a closer look
+    if(!ab && sz <= sizeof(int) && 0 != memcmp(a, b, sz))
+      anomaly = 1;
+  }
+  return anomaly;
+}
+
+// Select checking tier for current call (tiered=1):
+// comparators which showed anomalies in tier 0 probes are checked
+// at deep tier (ctx->deep) for next few calls.
+// Comparators which can not be tracked are checked as in non-tiered mode.
+static void select_tier(ErrorContext *ctx, const Comparator *cmp, const void *data, size_t n, size_t sz) {
+  CmpState *st = ctx->cmp_state = get_cmp_state(cmp->cmp);
+  if(!st)
+    return;
+
+  // Racy but ok
+  if(st->escalated) {
+    --st->escalated;
+    ctx->deep = 1;
+  } else if(check_tier0(ctx, cmp, data, n, sz)) {
+    st->escalated = flags.escalate - 1;
+    ctx->deep = 1;
+  }
+}
+
+static void run_deep_check(ErrorContext *ctx, const Comparator *cmp, DeepCheck check, const Perm *perm, void *data, size_t n, size_t sz) {
+  switch(check) {
+  case DEEP_BASIC:
+    check_basic(ctx, cmp, perm, 0, data, n, sz);
+    break;
+  case DEEP_TOTAL_ORDER:
+    check_total_order(ctx, cmp, perm, 0, data, n, sz);
+    break;
+  case DEEP_SORTED:
+    check_sorted(ctx, cmp, 0, data, n, sz);
+    break;
+  case DEEP_UNIQUE:
+    check_uniqueness(ctx, cmp, data, n, sz);
+    break;
+  default:
+    break;
+  }
+}
+
+// Run deep checks starting from the ones which most often
+// found errors in this comparator (and stop at first error)
+static void run_deep_checks(ErrorContext *ctx, const Comparator *cmp, CmpState *st, DeepCheck *checks, size_t nchecks, const Perm *perm, void *data, size_t n, size_t sz) {
+  size_t i, j;
+  if(st) {
+    for(i = 1; i < nchecks; ++i) {
+      DeepCheck c = checks[i];
+      for(j = i; j > 0 && st->fired[checks[j - 1]] < st->fired[c]; --j)
+        checks[j] = checks[j - 1];
+      checks[j] = c;
+    }
+  }
+
+  for(i = 0; i < nchecks && !ctx->found_error; ++i) {
+    run_deep_check(ctx, cmp, checks[i], perm, data, n, sz);
+    if(ctx->found_error && st)
+      __atomic_fetch_add(&st->fired[checks[i]], 1, __ATOMIC_RELAXED);
+  }
+}
+
+// Check comparator on array which is about to be sorted
+// (if it was sorted by previous call and only partly changed since,
+// check just the changed part).
+void check_sort_input(ErrorContext *ctx, const Comparator *cmp, void *data, size_t n, size_t sz) {
+  int protected_ = protect_data(ctx, data, n, sz);
+  size_t old_n;
+  if(flags.tiered)
+    select_tier(ctx, cmp, data, n, sz);
+  if(ctx->deep) {
+    Perm p;
+    const Perm *perm = get_perm(&p, ctx, n);
+    DeepCheck checks[] = { DEEP_BASIC, DEEP_TOTAL_ORDER };
+    run_deep_checks(ctx, cmp, ctx->cmp_state, checks, 2, perm, data, n, sz);
+  } else if(flags.incremental && (old_n = find_sorted_prefix(ctx, cmp, data, n, sz))) {
+    check_incremental(ctx, cmp, data, old_n, n, sz);
+  } else if(flags.tiered && ctx->cmp_state) {
+    // Probes are enough
+  } else {
+    Perm p;
+    const Perm *perm = get_perm(&p, ctx, n);
+    check_basic(ctx, cmp, perm, 0, data, n, sz);
+    check_total_order(ctx, cmp, perm, 0, data, n, sz);
+  }
+  if(protected_)
+    unprotect_data(ctx);
+}
+
+void check_sort_output(ErrorContext *ctx, const Comparator *cmp, void *data, size_t n, size_t sz) {
+  if(ctx->deep) {
+    if(!ctx->found_error) {
+      DeepCheck checks[] = { DEEP_SORTED, DEEP_UNIQUE };
+      run_deep_checks(ctx, cmp, ctx->cmp_state, checks, 2, 0, data, n, sz);
+    }
+  } else
+    check_uniqueness(ctx, cmp, data, n, sz);
+  // Independent of tier so that incremental=1 works in tiered mode
+  if(flags.incremental && !ctx->found_error)
+    remember_sorted(ctx, cmp, data, n, sz);
+}
+
+// Find policy for module which contains given address
+static const Policy *find_policy(const void *addr) {
+  update_maps();
+  const ProcMap *map = find_proc_map_for_addr(maps_head->maps, maps_head->nmaps, addr);
+  if(!map)
+    return 0;
+  size_t i;
+  for(i = 0; i < flags.npolicies; ++i) {
+    if(0 == fnmatch(flags.policies[i].glob, &map->name[0], 0))
+      return &flags.policies[i];
+  }
+  return 0;
+}
+
+// Find per-callsite state and select policy for current call
+// (returns 0 if call should not be checked)
+static int track_callsite(ErrorContext *ctx) {
+  Callsite *cs = get_callsite(ctx->ret_addr);
+  if(!cs)
+    return 1;
+  ctx->callsite = cs;
+
+  unsigned ncalls = __atomic_fetch_add(&cs->ncalls, 1, __ATOMIC_RELAXED);
+
+  if(!flags.npolicies)
+    return 1;
+
+  unsigned gen = (unsigned)dlopen_gen;
+  uint64_t policy_gen = __atomic_load_n(&cs->policy_gen, __ATOMIC_ACQUIRE);
+  if(policy_gen >> 32 != gen) {
+    // Module may have been unloaded and other module loaded at its place
+    // so need to reresolve
+    const Policy *p = find_policy(ctx->ret_addr);
+    policy_gen = ((uint64_t)gen << 32) | (p ? (uint64_t)(p - flags.policies) + 1 : 0);
+    __atomic_store_n(&cs->policy_gen, policy_gen, __ATOMIC_RELEASE);
+  }
+
+  uint32_t policy_idx = (uint32_t)policy_gen;
+  const Policy *p = ctx->policy = policy_idx ? &flags.policies[policy_idx - 1] : 0;
+  if(!p)
+    return 1;
+
+  if(p->has_checks && !p->checks)
+    return 0;
+
+  return p->rate <= 1 || ncalls % p->rate == 0;
+}
+
+int suppress_errors(ErrorContext *ctx) {
+  if(init_in_progress)
+    return 1;
+  if((flags.npolicies || flags.rotate || flags.print_stats || flags.incremental || flags.perf
+       || flags.sample || flags.cmp_cost || flags.lint)
+      && !track_callsite(ctx))
+    return 1;
+  if(num_errors >= flags.max_errors)
+    return 1;
+  // Uniqueness check (racy but ok)
+  size_t i;
+  for(i = 0; i < flags.max_errors; ++i) {
+    if (reported_errors[i].cmp == ctx->cmp_addr
+        && reported_errors[i].stack_hash == ctx->stack_hash)
+      return 1;
+  }
+  if(ctx->callsite)
+    __atomic_fetch_add(&ctx->callsite->nchecked, 1, __ATOMIC_RELAXED);
+  return 0;
+}
+
+// Print per-callsite statistics at exit
+static void print_stats(void) {
+  init_reporting();
+  update_maps();
+
+  FILE *f = out ? out : stderr;
+  fprintf(f, "sortcheck: stats for %s[%ld]:\n", proc_name, (long)getpid());
+
+  Callsite *cs;
+  for(cs = next_callsite(0); cs; cs = next_callsite(cs)) {
+    const char *module;
+    size_t offset;
+    addr_to_module(cs->ret_addr, &module, &offset);
+    fprintf(f, "  callsite %p (%s+0x%zx): %u calls, %u checked", cs->ret_addr, module, offset, cs->ncalls, cs->nchecked);
+    if(cs->nwindows) {
+      size_t covered = cs->cursor < cs->nwindows ? cs->cursor : cs->nwindows;
+      fprintf(f, ", window coverage %.1f%% (%zu of %zu windows)", 100.0 * covered / cs->nwindows, covered, cs->nwindows);
+    }
+    if(cs->nsampled) {
+      // Probability that single bad element is not in sample
+      double miss = 1.0 - (double)flags.sample / cs->max_sampled_n;
+      fprintf(f, ", %u sampled checks (miss probability up to %.1f%% per call)", cs->nsampled, 100.0 * miss);
+    }
+    fprintf(f, "\n");
+  }
+  fflush(f);
+}
+
+void perf_account(const ErrorContext *ctx, Stage stage, const PerfSample *start) {
+  Callsite *cs = ctx->callsite;
+  if(!cs)
+    return;
+
+  // Read counters before allocation so that it is not accounted
+  PerfSample end;
+  perf_read(&end);
+
+  PerfTotal *totals = __atomic_load_n(&cs->perf, __ATOMIC_ACQUIRE);
+  if(!totals) {
+    PerfTotal *new_totals = calloc(NUM_STAGES, sizeof(PerfTotal));
+    if(!new_totals)
+      return;
+    if(__atomic_compare_exchange_n(&cs->perf, &totals, new_totals, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      totals = new_totals;
+    else
+      free(new_totals);
+  }
+
+  PerfTotal *t = &totals[stage];
+  __atomic_fetch_add(&t->ncalls, 1, __ATOMIC_RELAXED);
+  int i;
+  for(i = 0; i < NUM_PERF_COUNTERS; ++i)
+    __atomic_fetch_add(&t->val[i], end.val[i] - start->val[i], __ATOMIC_RELAXED);
+}
+
+// Print per-callsite performance counters at exit
+static void print_perf(void) {
+  static const char *const stage_names[NUM_STAGES] = {
+    "real", "basic", "total_order", "window", "sorted", "unique", "bsearch_path", "tier0"
+  };
+
+  init_reporting();
+  update_maps();
+
+  FILE *f = out ? out : stderr;
+  fprintf(f, "sortcheck: perf counters for %s[%ld]:\n", proc_name, (long)getpid());
+
+  unsigned avail = perf_available();
+  if(!avail) {
+    fprintf(f, "  not available (see /proc/sys/kernel/perf_event_paranoid)\n");
+    fflush(f);
+    return;
+  }
+
+  Callsite *cs;
+  for(cs = next_callsite(0); cs; cs = next_callsite(cs)) {
+    if(!cs->perf)
+      continue;
+
+    const char *module;
+    size_t offset;
+    addr_to_module(cs->ret_addr, &module, &offset);
+    fprintf(f, "  callsite %p (%s+0x%zx):\n", cs->ret_addr, module, offset);
+
+    fprintf(f, "    %-14s %10s", "stage", "calls");
+    int i;
+    for(i = 0; i < NUM_PERF_COUNTERS; ++i)
+      fprintf(f, " %14s", perf_counter_names[i]);
+    fprintf(f, "\n");
+
+    int stage;
+    for(stage = 0; stage < NUM_STAGES; ++stage) {
+      const PerfTotal *t = &cs->perf[stage];
+      if(!t->ncalls)
+        continue;
+      fprintf(f, "    %-14s %10llu", stage_names[stage], (unsigned long long)t->ncalls);
+      for(i = 0; i < NUM_PERF_COUNTERS; ++i) {
+        if(avail & (1u << i))
+          fprintf(f, " %14llu", (unsigned long long)t->val[i]);
+        else
+          fprintf(f, " %14s", "n/a");
+      }
+      fprintf(f, "\n");
+    }
+  }
+  fflush(f);
+}
+
+// Average cost of comparison at callsite
+static inline double cmp_cost(const Callsite *cs) {
+  return (double)cs->cmp_ticks / cs->ncmp;
+}
+
+// Comparators which are this many times slower than median are reported
+#define CMP_COST_OUTLIER 8
+
+// Print per-callsite comparison counts and costs at exit
+static void print_cmp_cost(void) {
+  init_reporting();
+  update_maps();
+
+  FILE *f = out ? out : stderr;
+  fprintf(f, "sortcheck: comparator cost for %s[%ld]:\n", proc_name, (long)getpid());
+
+  // Median cost over callsites (insertion sort to avoid calling
+  // intercepted qsort)
+  Callsite *cs;
+  size_t ncs = 0, i, j;
+  for(cs = next_callsite(0); cs; cs = next_callsite(cs))
+    ncs += cs->ncmp != 0;
+  // Other threads may add callsites concurrently
+  // so fill at most ncs entries
+  double *costs = ncs ? malloc(ncs * sizeof(double)) : 0, median = 0;
+  if(costs) {
+    i = 0;
+    for(cs = next_callsite(0); cs && i < ncs; cs = next_callsite(cs)) {
+      if(!cs->ncmp)
+        continue;
+      double c = cmp_cost(cs);
+      for(j = i++; j > 0 && costs[j - 1] > c; --j)
+        costs[j] = costs[j - 1];
+      costs[j] = c;
+    }
+    median = i ? costs[i / 2] : 0;
+    free(costs);
+  }
+
+  for(cs = next_callsite(0); cs; cs = next_callsite(cs)) {
+    if(!cs->ncounted)
+      continue;
+    const char *module;
+    size_t offset;
+    addr_to_module(cs->ret_addr, &module, &offset);
+    fprintf(f, "  callsite %p (%s+0x%zx): %u calls, %llu comparisons", cs->ret_addr, module, offset, cs->ncounted, (unsigned long long)cs->ncmp);
+    if(cs->nexpected)
+      fprintf(f, " (%.2fx of expected)", (double)cs->ncmp / cs->nexpected);
+    if(cs->ncmp) {
+      double c = cmp_cost(cs);
+      fprintf(f, ", %.1f ticks per comparison", c);
+      // Median is meaningless for a couple of callsites
+      if(ncs >= 3 && c > CMP_COST_OUTLIER * median)
+        fprintf(f, " (outlier: %.1fx median)", c / median);
+    }
+    fprintf(f, "\n");
+  }
+  fflush(f);
+}
+
+static void print_redundant(FILE *f) {
+  Callsite *cs;
+  for(cs = next_callsite(0); cs; cs = next_callsite(cs)) {
+    if(!cs->nsorted_input && !cs->nrepeated_input)
+      continue;
+    const char *module;
+    size_t offset;
+    addr_to_module(cs->ret_addr, &module, &offset);
+    fprintf(f, "  callsite %p (%s+0x%zx): redundant sorts: %u of %u calls sort already sorted input, %u sort same content as previous call (~%llu comparisons and ~%llu bytes moved wasted)\n",
+            cs->ret_addr, module, offset, cs->nsorted_input, cs->nlinted, cs->nrepeated_input,
+            (unsigned long long)cs->wasted_cmp, (unsigned long long)cs->wasted_bytes);
+  }
+}
+
+// Callsites ranked by estimated wasted work
+static void print_usage(FILE *f) {
+  Callsite *cs;
+  size_t ncs = 0, i, j;
+  for(cs = next_callsite(0); cs; cs = next_callsite(cs))
+    ncs += cs->nused != 0;
+  Callsite **ranked = ncs ? malloc(ncs * sizeof(Callsite *)) : 0;
+  if(ncs && !ranked)
+    return;
+
+  // Insertion sort to avoid calling intercepted qsort
+  // (other threads may add callsites concurrently
+  // so fill at most ncs entries)
+  size_t nranked = 0;
+  for(cs = next_callsite(0); cs && nranked < ncs; cs = next_callsite(cs)) {
+    if(!cs->nused)
+      continue;
+    for(j = nranked++; j > 0 && (ranked[j - 1]->usage_waste < cs->usage_waste
+                           || (ranked[j - 1]->usage_waste == cs->usage_waste && ranked[j - 1]->nused < cs->nused)); --j)
+      ranked[j] = ranked[j - 1];
+    ranked[j] = cs;
+  }
+
+  fprintf(f, "  usage (ranked by estimated wasted work):\n");
+  for(i = 0; i < nranked; ++i) {
+    cs = ranked[i];
+    const char *module;
+    size_t offset;
+    addr_to_module(cs->ret_addr, &module, &offset);
+    double mean_n = (double)cs->sum_n / cs->nused;
+    double secs = (cs->last_ns - cs->first_ns) * 1e-9;
+    fprintf(f, "  #%zu callsite %p (%s+0x%zx): %s: %u calls", i + 1, cs->ret_addr, module, offset, cs->func, cs->nused);
+    if(secs > 0)
+      fprintf(f, " (%.0f/s)", cs->nused / secs);
+    fprintf(f, ", mean n %.0f, max n %llu, sz %zu\n", mean_n, (unsigned long long)cs->max_n, cs->max_sz);
+
+    fprintf(f, "      n histogram:");
+    unsigned k;
+    for(k = 0; k < SIZE_HIST_BUCKETS; ++k) {
+      if(!cs->n_hist[k])
+        continue;
+      if(k == 0)
+        fprintf(f, " 0:%u", cs->n_hist[k]);
+      else
+        fprintf(f, " %llu-%llu:%u", 1ull << (k - 1), (1ull << k) - 1, cs->n_hist[k]);
+    }
+    fprintf(f, "\n");
+
+    unsigned long long waste = cs->usage_waste;
+    if(cs->issues & USAGE_LINEAR_SEARCH)
+      fprintf(f, "      linear search over n~%.0f called %u times: use sorted array and bsearch or hash table (~%llu wasted comparisons)\n", mean_n, cs->nused, waste);
+    if(cs->issues & USAGE_SMALL_BSEARCH)
+      fprintf(f, "      binary search over n~%.0f: use inline linear scan (~%llu avoidable comparator calls)\n", mean_n, waste);
+    if(cs->issues & USAGE_LARGE_ELEMS)
+      fprintf(f, "      sort of %zu-byte elements: sort array of pointers or indices instead (moves cost ~%llu comparisons)\n", cs->max_sz, waste);
+  }
+
+  free(ranked);
+}
+
+// Print per-callsite lint results at exit
+static void print_lint(void) {
+  init_reporting();
+  update_maps();
+
+  FILE *f = out ? out : stderr;
+  fprintf(f, "sortcheck: lint results for %s[%ld]:\n", proc_name, (long)getpid());
+  if(flags.lint & LINT_REDUNDANT)
+    print_redundant(f);
+  if(flags.lint & LINT_USAGE)
+    print_usage(f);
+  fflush(f);
+}
+
+// Write-protect sorted array while checker runs comparator
+// (to detect modifying comparators without checksumming).
+int protect_data(ErrorContext *ctx, void *data, size_t n, size_t sz) {
+  char *begin, *end;
+  if(!flags.protect || !(get_checks(ctx) & CHECK_BASIC)
+      || !protect_begin(data, n * sz, &begin, &end))
+    return 0;
+  ctx->prot_begin = begin;
+  ctx->prot_end = end;
+  return 1;
+}
+
+void unprotect_data(ErrorContext *ctx) {
+  ctx->prot_begin = ctx->prot_end = 0;
+  if(protect_end())
+    report_error(ctx, "comparison function modifies data");
+}
@@ -8,6 +8,7 @@
 #include <checksum.h>
 
 #include <stdint.h>
+#include <string.h>
 
 unsigned checksum(const void *data, size_t sz) {
   uint16_t s1 = 0, s2 = 0;
@@ -19,4 +20,32 @@ unsigned checksum(const void *data, size_t sz) {
   return s1 | (s2 << 8);
 }
 
+uint64_t hash_words(uint64_t h, const void *data, size_t sz) {
+  const char *p = data;
+  size_t i;
+  for(i = 0; i + 8 <= sz; i += 8) {
+    uint64_t w;
+    memcpy(&w, p + i, 8);
+    h = (h ^ w) * 0x9e3779b97f4a7c15ull;
+    h ^= h >> 32;
+  }
+  return fnv1a(h, p + i, sz - i);
+}
+
+// Number of elements used for fingerprint
+#define NUM_SAMPLES 16
 
+// Max number of hashed bytes in each element
+#define MAX_SAMPLE_BYTES 64
+
+uint64_t fingerprint(const void *data, size_t n, size_t sz) {
+  uint64_t h = FNV1A_INIT;
+  size_t nsamples = n < NUM_SAMPLES ? n : NUM_SAMPLES;
+  size_t bytes = sz < MAX_SAMPLE_BYTES ? sz : MAX_SAMPLE_BYTES;
+  size_t i;
+  for(i = 0; i < nsamples; ++i) {
+    size_t idx = nsamples > 1 ? i * (n - 1) / (nsamples - 1) : 0;
+    h = fnv1a(h, (const char *)data + idx * sz, bytes);
+  }
+  return h;
+}
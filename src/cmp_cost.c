@@ -0,0 +1,66 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <cmp_cost.h>
+
+// Sort implementations switch to insertion sort for arrays
+// of this size (which makes up to n * (n - 1) / 2 comparisons)
+#define SMALL_SORT 16
+
+static __thread CmpShim *cur_shim;
+
+static inline int call_cmp(CmpShim *s, const void *a, const void *b) {
+  uint64_t start = read_ticks();
+  int res = s->c.is_reentrant
+    ? ((cmp_r_fun_t)s->c.cmp)(a, b, s->c.arg)
+    : ((cmp_fun_t)s->c.cmp)(a, b);
+  s->ticks += read_ticks() - start;
+  ++s->ncmp;
+  return res;
+}
+
+int cmp_shim(const void *a, const void *b) {
+  return call_cmp(cur_shim, a, b);
+}
+
+int cmp_shim_r(const void *a, const void *b, void *arg) {
+  return call_cmp(arg, a, b);
+}
+
+void cmp_shim_begin(CmpShim *s, const Comparator *c) {
+  s->c = *c;
+  s->ncmp = s->ticks = 0;
+  s->shim_c.cmp = cmp_shim_r;
+  s->shim_c.arg = s;
+  s->shim_c.is_reentrant = 1;
+  s->prev = cur_shim;
+  cur_shim = s;
+}
+
+void cmp_shim_end(ErrorContext *ctx, CmpShim *s, size_t n, int is_search, int report) {
+  cur_shim = s->prev;
+
+  // Search makes at most log2(n) + 1 comparisons and sort n * log2(n)
+  // (or n * (n - 1) / 2 for small arrays)
+  uint64_t expected = is_search ? log2_ceil(n) + 1
+    : n <= SMALL_SORT ? (uint64_t)n * (n - 1) / 2
+    : (uint64_t)n * log2_ceil(n);
+
+  Callsite *cs = ctx->callsite;
+  if(cs) {
+    __atomic_fetch_add(&cs->ncounted, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&cs->ncmp, s->ncmp, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&cs->cmp_ticks, s->ticks, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&cs->nexpected, expected, __ATOMIC_RELAXED);
+  }
+
+  uint64_t limit = flags.cmp_cost * expected;
+  if(report && expected && s->ncmp > limit) {
+    report_error(ctx, "excessive number of comparisons (%llu for %zu elements, limit %llu)",
+                 (unsigned long long)s->ncmp, n, (unsigned long long)limit);
+  }
+}
@@ -0,0 +1,20 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <cmp_state.h>
+#include <addr_table.h>
+
+#define CMP_TABLE_SIZE 1024
+
+static CmpState cmp_table[CMP_TABLE_SIZE];
+static int cmp_table_state[CMP_TABLE_SIZE];
+
+static AddrTable cmp_states = ADDR_TABLE_INIT(cmp_table, cmp_table_state);
+
+CmpState *get_cmp_state(const void *cmp) {
+  return addr_table_get(&cmp_states, cmp);
+}
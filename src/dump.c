@@ -0,0 +1,107 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <dump.h>
+#include <io.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int write_dump(const char *dir, DumpHeader *hdr, const char *func, const char *module, const char *opts, const char *msg, const char *data, const size_t *idx, const char *key, char *fname, size_t fname_size) {
+  static unsigned ndumps;
+
+  memcpy(hdr->magic, DUMP_MAGIC, sizeof(hdr->magic));
+  hdr->version = 2;
+  hdr->pid = getpid();
+  hdr->func_len = strlen(func) + 1;
+  hdr->module_len = strlen(module) + 1;
+  hdr->opts_len = strlen(opts) + 1;
+  hdr->msg_len = strlen(msg) + 1;
+  hdr->has_key = key != 0;
+
+  size_t strs_size = hdr->func_len + hdr->module_len + hdr->opts_len + hdr->msg_len;
+  size_t size = sizeof(*hdr) + strs_size + (hdr->n + hdr->has_key) * hdr->sz;
+  char *buf = malloc(size), *p = buf;
+  if(!buf)
+    return 0;
+
+#define APPEND(src, len) do { memcpy(p, src, len); p += len; } while(0)
+  APPEND(hdr, sizeof(*hdr));
+  APPEND(func, hdr->func_len);
+  APPEND(module, hdr->module_len);
+  APPEND(opts, hdr->opts_len);
+  APPEND(msg, hdr->msg_len);
+  size_t i;
+  for(i = 0; i < hdr->n; ++i)
+    APPEND(data + (idx ? idx[i] : i) * hdr->sz, hdr->sz);
+  if(key)
+    APPEND(key, hdr->sz);
+#undef APPEND
+
+  // Directory may already exist
+  mkdir(dir, 0777);
+
+  int fd = -1;
+  while(fd < 0) {
+    unsigned k = __atomic_fetch_add(&ndumps, 1, __ATOMIC_RELAXED);
+    snprintf(fname, fname_size, "%s/sortcheck-%ld-%u.bin", dir, (long)getpid(), k);
+    fd = open(fname, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if(fd < 0 && errno != EEXIST)
+      break;
+  }
+
+  int ok = fd >= 0 && write(fd, buf, size) == (ssize_t)size;
+  if(fd >= 0)
+    close(fd);
+  free(buf);
+  return ok;
+}
+
+int read_dump(const char *fname, Dump *d) {
+  memset(d, 0, sizeof(*d));
+
+  size_t size;
+  d->buf = read_file(fname, &size);
+  if(!d->buf || size < sizeof(DumpHeader))
+    goto bad;
+
+  memcpy(&d->hdr, d->buf, sizeof(DumpHeader));
+  const DumpHeader *h = &d->hdr;
+  if(0 != memcmp(h->magic, DUMP_MAGIC, sizeof(h->magic)) || h->version != 2)
+    goto bad;
+
+  size_t strs_size = (size_t)h->func_len + h->module_len + h->opts_len + h->msg_len;
+  if(!h->sz || h->n > DUMP_MAX_ELEMS || h->sz > DUMP_MAX_BYTES || h->has_key > 1
+      || size != sizeof(DumpHeader) + strs_size + (h->n + h->has_key) * h->sz)
+    goto bad;
+
+  const char *p = d->buf + sizeof(DumpHeader);
+#define TAKE(dst, len) do { dst = p; p += len; if(!(len) || p[-1]) goto bad; } while(0)
+  TAKE(d->func, h->func_len);
+  TAKE(d->module, h->module_len);
+  TAKE(d->opts, h->opts_len);
+  TAKE(d->msg, h->msg_len);
+#undef TAKE
+  d->data = p;
+  d->key = h->has_key ? p + h->n * h->sz : 0;
+  return 1;
+
+bad:
+  free_dump(d);
+  return 0;
+}
+
+void free_dump(Dump *d) {
+  free(d->buf);
+  d->buf = 0;
+}
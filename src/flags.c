@@ -6,10 +6,134 @@
  */
 
 #include <flags.h>
+#include <backtrace.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+
+#include <sys/time.h>
+#include <unistd.h>
+
+// Parse number or "rand"
+static unsigned parse_seed(const char *value) {
+  if(0 == strcmp(value, "rand") || 0 == strcmp(value, "random")) {
+    // Do not use rand() to avoid changing state of user's PRNG
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return (unsigned)(tv.tv_sec ^ tv.tv_usec ^ ((long)getpid() << 16)) & INT_MAX;
+  }
+  return (unsigned)atoi(value);
+}
+
+// Parse comma-separated list of checks
+static int parse_checks(char *value, unsigned *pchecks) {
+  unsigned checks = 0;
+  do {
+    char *next = strchr(value, ',');
+    if(next) {
+      *next = 0;
+      ++next;
+    }
+
+    int no = 0;
+    if(0 == strncmp(value, "no_", 3)) {
+      no = 1;
+      value += 3;
+    }
+
+#define PARSE_CHECK(m, s) if(0 == strcmp(s, value)) { \
+  if(no) checks &= ~m; else checks |= m; \
+} else
+    PARSE_CHECK(CHECK_BASIC, "basic")
+    PARSE_CHECK(CHECK_REFLEXIVITY, "reflexivity")
+    PARSE_CHECK(CHECK_SYMMETRY, "symmetry")
+    PARSE_CHECK(CHECK_TRANSITIVITY, "transitivity")
+    PARSE_CHECK(CHECK_SORTED, "sorted")
+    PARSE_CHECK(CHECK_GOOD_BSEARCH, "good_bsearch")
+    PARSE_CHECK(CHECK_UNIQUE, "unique")
+    PARSE_CHECK(CHECK_DEFAULT, "default")
+    PARSE_CHECK(CHECK_ALL, "all")
+    PARSE_CHECK(0, "none")
+    {
+      fprintf(stderr, "sortcheck: unknown check '%s'\n", value);
+      return 0;
+    }
+    value = next;
+  } while(value);
+  *pchecks = checks;
+  return 1;
+}
+
+// Parse comma-separated list of lints
+static int parse_lints(char *value, unsigned *plints) {
+  unsigned lints = 0;
+  do {
+    char *next = strchr(value, ',');
+    if(next) {
+      *next = 0;
+      ++next;
+    }
+
+    if(0 == strcmp(value, "redundant"))
+      lints |= LINT_REDUNDANT;
+    else if(0 == strcmp(value, "usage"))
+      lints |= LINT_USAGE;
+    else if(0 == strcmp(value, "none"))
+      lints = 0;
+    else {
+      fprintf(stderr, "sortcheck: unknown lint '%s'\n", value);
+      return 0;
+    }
+    value = next;
+  } while(value);
+  *plints = lints;
+  return 1;
+}
+
+// Parse "GLOB;check=...;window=...;budget=...;rate=..."
+static int parse_policy(char *value, Policy *p) {
+  memset(p, 0, sizeof(*p));
+
+  char *end = strchr(value, ';');
+  if(end)
+    *end = 0;
+  p->glob = strdup(value);
+
+  while(end) {
+    char *field = end + 1;
+    if((end = strchr(field, ';')))
+      *end = 0;
+
+    char *assign = strchr(field, '=');
+    if(!assign) {
+      fprintf(stderr, "sortcheck: missing '=' in policy field '%s'\n", field);
+      return 0;
+    }
+    *assign = 0;
+    char *fvalue = assign + 1;
+
+    if(0 == strcmp(field, "check")) {
+      if(!parse_checks(fvalue, &p->checks))
+        return 0;
+      p->has_checks = 1;
+    } else if(0 == strcmp(field, "window")) {
+      int window = atoi(fvalue);
+      if (window > 0)
+        p->window = window < MAX_WINDOW ? window : MAX_WINDOW;
+    } else if(0 == strcmp(field, "budget")) {
+      p->budget = atoi(fvalue);
+    } else if(0 == strcmp(field, "rate")) {
+      p->rate = atoi(fvalue);
+    } else {
+      fprintf(stderr, "sortcheck: unknown policy field '%s'\n", field);
+      return 0;
+    }
+  }
+
+  return 1;
+}
 
 int parse_flags(char *opt, Flags *flags) {
   // Skip parasite newlines inserted by some editors
@@ -41,56 +165,82 @@ int parse_flags(char *opt, Flags *flags) {
       flags->print_to_syslog = atoi(value);
     } else if(0 == strcmp(name, "print_to_file")) {
       flags->out_filename = strdup(value);
+    } else if(0 == strcmp(name, "dump_dir")) {
+      flags->dump_dir = strdup(value);
+    } else if(0 == strcmp(name, "trace")) {
+      flags->trace_prefix = strdup(value);
     } else if(0 == strcmp(name, "report_error")) {
       flags->report_error = atoi(value);
     } else if(0 == strcmp(name, "max_errors")) {
       int max_errors = atoi(value);
       if (max_errors >= 0)
-        flags->max_errors = max_errors < 1024 ? max_errors : 1024;;
+        flags->max_errors = max_errors < MAX_ERRORS ? max_errors : MAX_ERRORS;
+    } else if(0 == strcmp(name, "bsearch_cache")) {
+      flags->bsearch_cache = atoi(value);
+    } else if(0 == strcmp(name, "lsearch_cache")) {
+      flags->lsearch_cache = atoi(value);
+    } else if(0 == strcmp(name, "bsearch_path")) {
+      flags->bsearch_path = atoi(value);
+    } else if(0 == strcmp(name, "protect")) {
+      flags->protect = atoi(value);
+    } else if(0 == strcmp(name, "print_stats")) {
+      flags->print_stats = atoi(value);
+    } else if(0 == strcmp(name, "incremental")) {
+      flags->incremental = atoi(value);
+    } else if(0 == strcmp(name, "replace_sort")) {
+      flags->replace_sort = atoi(value);
+    } else if(0 == strcmp(name, "perf")) {
+      flags->perf = atoi(value);
+    } else if(0 == strcmp(name, "tiered")) {
+      flags->tiered = atoi(value);
+    } else if(0 == strcmp(name, "sample")) {
+      int sample = atoi(value);
+      if (sample >= 0)
+        flags->sample = sample;
+    } else if(0 == strcmp(name, "cmp_cost")) {
+      int cmp_cost = atoi(value);
+      if (cmp_cost >= 0)
+        flags->cmp_cost = cmp_cost;
+    } else if(0 == strcmp(name, "escalate")) {
+      int escalate = atoi(value);
+      if (escalate > 0)
+        flags->escalate = escalate;
     } else if(0 == strcmp(name, "raise")) {
       flags->raise = atoi(value);
     } else if(0 == strcmp(name, "sleep")) {
       flags->sleep = atoi(value);
     } else if(0 == strcmp(name, "check")) {
-      unsigned checks = 0;
-      do {
-        char *next = strchr(value, ',');
-        if(next) {
-          *next = 0;
-          ++next;
-        }
-
-        int no = 0;
-        if(0 == strncmp(value, "no_", 3)) {
-          no = 1;
-          value += 3;
-        }
-
-#define PARSE_CHECK(m, s) if(0 == strcmp(s, value)) { \
-  if(no) checks &= ~m; else checks |= m; \
-} else
-        PARSE_CHECK(CHECK_BASIC, "basic")
-        PARSE_CHECK(CHECK_REFLEXIVITY, "reflexivity")
-        PARSE_CHECK(CHECK_SYMMETRY, "symmetry")
-        PARSE_CHECK(CHECK_TRANSITIVITY, "transitivity")
-        PARSE_CHECK(CHECK_SORTED, "sorted")
-        PARSE_CHECK(CHECK_GOOD_BSEARCH, "good_bsearch")
-        PARSE_CHECK(CHECK_UNIQUE, "unique")
-        PARSE_CHECK(CHECK_DEFAULT, "default")
-        PARSE_CHECK(CHECK_ALL, "all")
-        {
-          fprintf(stderr, "sortcheck: unknown check '%s'\n", value);
-          return 0;
-        }
-        value = next;
-      } while(value);
-      flags->checks = checks;
+      if(!parse_checks(value, &flags->checks))
+        return 0;
+    } else if(0 == strcmp(name, "lint")) {
+      if(!parse_lints(value, &flags->lint))
+        return 0;
+    } else if(0 == strcmp(name, "policy")) {
+      if(flags->npolicies >= MAX_POLICIES) {
+        fprintf(stderr, "sortcheck: too many policies\n");
+        return 0;
+      }
+      if(!parse_policy(value, &flags->policies[flags->npolicies]))
+        return 0;
+      ++flags->npolicies;
     } else if(0 == strcmp(name, "start")) {
-      int random = 0 == strcmp(name, "rand") || 0 == strcmp(name, "random");
-      flags->start = (unsigned)(random ? rand() : atoi(value));
+      flags->rotate = 0 == strcmp(value, "rotate");
+      if(!flags->rotate)
+        flags->start = parse_seed(value);
     } else if(0 == strcmp(name, "shuffle")) {
-      int random = 0 == strcmp(name, "rand") || 0 == strcmp(name, "random");
-      flags->shuffle = (unsigned)(random ? rand() : atoi(value));
+      flags->shuffle = parse_seed(value);
+    } else if(0 == strcmp(name, "backtrace")) {
+      int depth = atoi(value);
+      if (depth >= 0)
+        flags->backtrace = depth < MAX_BACKTRACE_DEPTH ? depth : MAX_BACKTRACE_DEPTH;
+    } else if(0 == strcmp(name, "window")) {
+      int window = atoi(value);
+      if (window > 0)
+        flags->window = window < MAX_WINDOW ? window : MAX_WINDOW;
+    } else if(0 == strcmp(name, "threads")) {
+      int threads = atoi(value);
+      if (threads >= 0)
+        flags->threads = threads;
     } else {
       fprintf(stderr, "sortcheck: unknown option '%s'\n", name);
       return 0;
@@ -0,0 +1,542 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// In-process comparator fuzzer: loads comparator from shared object
+// and feeds generated arrays directly to checking engine.
+
+#include <checker.h>
+#include <perm.h>
+#include <resolve.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_FIELDS 64
+
+typedef struct {
+  char kind;  // 'i' (signed), 'u' (unsigned), 'f' (float), 's' (string), 'b' (bytes)
+  size_t off, size;
+} Field;
+
+static Field fields[MAX_FIELDS];
+static size_t nfields;
+static size_t elem_size;
+
+// Seed corpus
+typedef struct {
+  char *data;
+  size_t n;
+} Input;
+
+static Input *corpus;
+static size_t ncorpus;
+
+static uint64_t rng_state;
+
+static void usage(const char *prog) {
+  printf("\
+Usage: %s [OPTION]... MODULE SYMBOL\n\
+Check comparison function SYMBOL from shared object MODULE\n\
+on generated arrays. SYMBOL may also be a hex offset\n\
+(e.g. 0x1139) from module base, as printed in reports.\n\
+\n\
+Options:\n\
+  -l LAYOUT  Comma-separated list of element fields:\n\
+             iN/uN - signed/unsigned N-bit int, f32/f64 - float,\n\
+             sN - string in N-byte buffer, bN - N opaque bytes\n\
+             (fields are aligned as in C struct).\n\
+  -z SIZE    Element size (default is size of LAYOUT or 4).\n\
+  -n MAXN    Maximum array size (default 16).\n\
+  -c DIR     Seed corpus (files with raw arrays of elements).\n\
+  -i ITERS   Number of iterations per job (default unlimited).\n\
+  -t SECS    Time limit (default unlimited).\n\
+  -j JOBS    Number of parallel processes (default 1).\n\
+  -s SEED    Seed for generator (default 0).\n\
+  -o FILE    Where to save failing input (default sortcheck-fuzz.bin).\n\
+  -r         Comparator takes additional argument (as in qsort_r).\n\
+  -h         Print this help and exit.\n\
+\n\
+Checks can be customized via SORTCHECK_OPTIONS.\n\
+", prog);
+}
+
+static unsigned rnd(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return (unsigned)((rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static uint64_t rnd64(void) {
+  return ((uint64_t)rnd() << 32) | rnd();
+}
+
+static int parse_layout(const char *s) {
+  size_t off = 0, max_align = 1;
+  while(*s) {
+    if(nfields == MAX_FIELDS) {
+      fprintf(stderr, "sortcheck-fuzz: too many fields in layout\n");
+      return 0;
+    }
+    Field *f = &fields[nfields++];
+    f->kind = *s++;
+    char *end;
+    unsigned long width = strtoul(s, &end, 10);
+    s = *end == ',' ? end + 1 : end;
+    size_t align;
+    switch(f->kind) {
+    case 'i':
+    case 'u':
+      if(width != 8 && width != 16 && width != 32 && width != 64)
+        goto bad;
+      f->size = align = width / 8;
+      break;
+    case 'f':
+      if(width != 32 && width != 64)
+        goto bad;
+      f->size = align = width / 8;
+      break;
+    case 's':
+    case 'b':
+      if(!width)
+        goto bad;
+      f->size = width;
+      align = 1;
+      break;
+    default:
+      goto bad;
+    }
+    off = (off + align - 1) & ~(align - 1);
+    f->off = off;
+    off += f->size;
+    if(align > max_align)
+      max_align = align;
+    continue;
+bad:
+    fprintf(stderr, "sortcheck-fuzz: bad field '%c%lu' in layout\n", f->kind, width);
+    return 0;
+  }
+  elem_size = (off + max_align - 1) & ~(max_align - 1);
+  return 1;
+}
+
+static void read_corpus(const char *dir) {
+  DIR *d = opendir(dir);
+  if(!d) {
+    fprintf(stderr, "sortcheck-fuzz: failed to open %s\n", dir);
+    exit(1);
+  }
+  struct dirent *e;
+  while((e = readdir(d))) {
+    char path[PATH_MAX];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+    if(stat(path, &st) || !S_ISREG(st.st_mode) || (size_t)st.st_size < elem_size)
+      continue;
+    FILE *in = fopen(path, "rb");
+    if(!in)
+      continue;
+    Input inp;
+    inp.n = st.st_size / elem_size;
+    inp.data = malloc(inp.n * elem_size);
+    if(!inp.data) {
+      fprintf(stderr, "sortcheck-fuzz: failed to allocate memory for %s\n", path);
+      exit(1);
+    }
+    // File may have shrunk since stat
+    inp.n = fread(inp.data, elem_size, inp.n, in);
+    fclose(in);
+    if(!inp.n) {
+      free(inp.data);
+      continue;
+    }
+    Input *new_corpus = realloc(corpus, (ncorpus + 1) * sizeof(Input));
+    if(!new_corpus) {
+      fprintf(stderr, "sortcheck-fuzz: failed to allocate memory for corpus\n");
+      exit(1);
+    }
+    corpus = new_corpus;
+    corpus[ncorpus++] = inp;
+  }
+  closedir(d);
+}
+
+static void store_int(char *p, size_t size, uint64_t v) {
+  switch(size) {
+  case 1: { uint8_t x = v; memcpy(p, &x, 1); break; }
+  case 2: { uint16_t x = v; memcpy(p, &x, 2); break; }
+  case 4: { uint32_t x = v; memcpy(p, &x, 4); break; }
+  default: memcpy(p, &v, 8); break;
+  }
+}
+
+static uint64_t load_int(const char *p, size_t size) {
+  switch(size) {
+  case 1: { uint8_t x; memcpy(&x, p, 1); return x; }
+  case 2: { uint16_t x; memcpy(&x, p, 2); return x; }
+  case 4: { uint32_t x; memcpy(&x, p, 4); return x; }
+  default: { uint64_t x; memcpy(&x, p, 8); return x; }
+  }
+}
+
+static void store_float(char *p, size_t size, double v) {
+  if(size == 4) {
+    float x = v;
+    memcpy(p, &x, 4);
+  } else
+    memcpy(p, &v, 8);
+}
+
+static double load_float(const char *p, size_t size) {
+  if(size == 4) {
+    float x;
+    memcpy(&x, p, 4);
+    return x;
+  }
+  double x;
+  memcpy(&x, p, 8);
+  return x;
+}
+
+// Values which often trigger bugs in comparators
+static void gen_field(const Field *f, char *elem) {
+  char *p = elem + f->off;
+  size_t i, bits = 8 * f->size;
+  switch(f->kind) {
+  case 'i':
+  case 'u': {
+    uint64_t min = f->kind == 'i' ? (uint64_t)1 << (bits - 1) : 0;
+    uint64_t max = min - 1;
+    uint64_t v;
+    switch(rnd() % 8) {
+    case 0: v = 0; break;
+    case 1: v = min; break;
+    case 2: v = max; break;
+    case 3: v = rnd() % 2 ? min + 1 : max - 1; break;
+    case 4: case 5: v = (uint64_t)(int64_t)((int)(rnd() % 33) - 16); break;
+    default: v = rnd64(); break;
+    }
+    store_int(p, f->size, v);
+    break;
+  }
+  case 'f': {
+    static const double special[] = {
+      0.0, -0.0, 1.0, -1.0, NAN, INFINITY, -INFINITY,
+      DBL_MIN, DBL_MIN / 4, DBL_EPSILON, DBL_MAX, FLT_MAX
+    };
+    double v;
+    if(rnd() % 2)
+      v = special[rnd() % (sizeof(special) / sizeof(special[0]))];
+    else
+      v = ((double)rnd() / UINT_MAX - 0.5) * (rnd() % 2 ? 4 : 1e6);
+    store_float(p, f->size, v);
+    break;
+  }
+  case 's': {
+    // Small alphabet to get common prefixes and case-only differences
+    static const char alphabet[] = "aAbB0 ";
+    size_t len = rnd() % f->size;
+    for(i = 0; i < len; ++i)
+      p[i] = alphabet[rnd() % (sizeof(alphabet) - 1)];
+    memset(p + len, 0, f->size - len);
+    break;
+  }
+  default: {
+    static const unsigned char bytes[] = { 0, 1, 0x7f, 0x80, 0xff };
+    int small = rnd() % 2;
+    for(i = 0; i < f->size; ++i)
+      p[i] = small ? bytes[rnd() % sizeof(bytes)] : rnd();
+    break;
+  }
+  }
+}
+
+// Make field slightly different from given value
+static void perturb_field(const Field *f, char *elem, const char *other) {
+  char *p = elem + f->off;
+  const char *q = other + f->off;
+  switch(f->kind) {
+  case 'i':
+  case 'u':
+    store_int(p, f->size, load_int(q, f->size) + (rnd() % 2 ? 1 : -1));
+    break;
+  case 'f': {
+    double v = load_float(q, f->size);
+    if(rnd() % 2)
+      v = nextafter(v, rnd() % 2 ? INFINITY : -INFINITY);
+    else
+      v += (rnd() % 2 ? 1 : -1) * (fabs(v) + 1) * 1e-3;
+    store_float(p, f->size, v);
+    break;
+  }
+  default:
+    memcpy(p, q, f->size);
+    p[rnd() % f->size] ^= 1 << (rnd() % 8);
+    if(f->kind == 's')
+      p[f->size - 1] = 0;
+    break;
+  }
+}
+
+static void mutate(char *data, size_t n) {
+  size_t i = rnd() % n, j = rnd() % n;
+  char *a = data + i * elem_size, *b = data + j * elem_size;
+  const Field *f = &fields[rnd() % nfields];
+  switch(rnd() % 6) {
+  case 0:
+    gen_field(f, a);
+    break;
+  case 1:
+    // Ties are a common source of errors
+    memcpy(a + f->off, b + f->off, f->size);
+    break;
+  case 2:
+    perturb_field(f, a, b);
+    break;
+  case 3:
+    memcpy(a, b, elem_size);
+    break;
+  case 4: {
+    // Copy prefix of string
+    if(f->kind != 's')
+      break;
+    size_t len = rnd() % f->size;
+    memcpy(a + f->off, b + f->off, len);
+    break;
+  }
+  default:
+    if(i != j) {
+      char tmp[elem_size];
+      memcpy(tmp, a, elem_size);
+      memcpy(a, b, elem_size);
+      memcpy(b, tmp, elem_size);
+    }
+    break;
+  }
+}
+
+static size_t gen_input(char *data, size_t maxn) {
+  size_t i, k, n;
+  if(ncorpus && rnd() % 2) {
+    const Input *inp = &corpus[rnd() % ncorpus];
+    n = inp->n < maxn ? inp->n : maxn;
+    size_t start = rnd() % (inp->n - n + 1);
+    memcpy(data, inp->data + start * elem_size, n * elem_size);
+  } else {
+    n = 2 + rnd() % (maxn - 1);
+    for(i = 0; i < n; ++i)
+    for(k = 0; k < nfields; ++k)
+      gen_field(&fields[k], data + i * elem_size);
+  }
+  size_t nmut = 1 + rnd() % 4;
+  for(k = 0; k < nmut; ++k)
+    mutate(data, n);
+  return n;
+}
+
+static void save_input(const char *fname, const char *data, size_t n) {
+  FILE *f = fopen(fname, "wb");
+  if(!f || fwrite(data, elem_size, n, f) != n) {
+    fprintf(stderr, "sortcheck-fuzz: failed to write %s\n", fname);
+    exit(1);
+  }
+  fclose(f);
+  fprintf(stderr, "sortcheck-fuzz: failing input (%zu elements) saved to %s\n", n, fname);
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int fuzz(const Comparator *c, unsigned seed, unsigned long iters, unsigned secs, size_t maxn, const char *out_fname) {
+  rng_state = 0x9E3779B97F4A7C15ULL * (seed + 1);
+
+  char *data = malloc(maxn * elem_size);
+  size_t *idx = malloc(maxn * sizeof(size_t));
+  size_t i;
+  for(i = 0; i < maxn; ++i)
+    idx[i] = i;
+
+  double start = now();
+  unsigned long iter;
+  for(iter = 0; !iters || iter < iters; ++iter) {
+    if(secs && iter % 1024 == 0 && now() - start >= secs)
+      break;
+
+    size_t n = gen_input(data, maxn);
+
+    ErrorContext ctx = { .func = "fuzz", .cmp_addr = c->cmp, .ret_addr = __builtin_return_address(0) };
+    check_basic(&ctx, c, 0, 0, data, n, elem_size);
+    if(!ctx.found_error)
+      check_window(&ctx, c, data, elem_size, idx, n);
+
+    if(ctx.found_error) {
+      save_input(out_fname, data, n);
+      free(data);
+      free(idx);
+      return 1;
+    }
+  }
+
+  double elapsed = now() - start;
+  fprintf(stderr, "sortcheck-fuzz: %lu iterations", iter);
+  if(elapsed > 0)
+    fprintf(stderr, " (%.0f/s)", iter / elapsed);
+  fprintf(stderr, ", no errors found\n");
+
+  free(data);
+  free(idx);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  const char *layout = 0, *corpus_dir = 0, *out_fname = "sortcheck-fuzz.bin";
+  size_t maxn = 16;
+  unsigned long iters = 0;
+  unsigned secs = 0, njobs = 1, seed = 0;
+  int is_reentrant = 0;
+
+  int opt;
+  while((opt = getopt(argc, argv, "l:z:n:c:i:t:j:s:o:rh")) != -1) {
+    switch(opt) {
+    case 'l':
+      layout = optarg;
+      break;
+    case 'z':
+      elem_size = atol(optarg);
+      break;
+    case 'n':
+      maxn = atol(optarg);
+      break;
+    case 'c':
+      corpus_dir = optarg;
+      break;
+    case 'i':
+      iters = strtoul(optarg, 0, 10);
+      break;
+    case 't':
+      secs = atoi(optarg);
+      break;
+    case 'j':
+      njobs = atoi(optarg);
+      break;
+    case 's':
+      seed = atoi(optarg);
+      break;
+    case 'o':
+      out_fname = optarg;
+      break;
+    case 'r':
+      is_reentrant = 1;
+      break;
+    case 'h':
+      usage(argv[0]);
+      return 0;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if(optind + 2 != argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if(maxn < 2 || maxn > MAX_WINDOW) {
+    fprintf(stderr, "sortcheck-fuzz: array size should be in [2, %d]\n", MAX_WINDOW);
+    return 1;
+  }
+
+  // Layout overrides element size
+  if(layout) {
+    size_t sz = elem_size;
+    if(!parse_layout(layout))
+      return 1;
+    if(sz && sz < elem_size) {
+      fprintf(stderr, "sortcheck-fuzz: element size is smaller than layout\n");
+      return 1;
+    }
+    if(sz)
+      elem_size = sz;
+  } else {
+    if(!elem_size)
+      elem_size = 4;
+    fields[0].kind = 'b';
+    fields[0].off = 0;
+    fields[0].size = elem_size;
+    nfields = 1;
+  }
+
+  if(corpus_dir)
+    read_corpus(corpus_dir);
+
+  init();
+
+  Comparator c;
+  c.cmp = resolve_cmp("sortcheck-fuzz", argv[optind], argv[optind + 1]);
+  c.arg = 0;
+  c.is_reentrant = is_reentrant;
+  if(!c.cmp)
+    return 1;
+
+  if(njobs <= 1)
+    return fuzz(&c, seed, iters, secs, maxn, out_fname);
+
+  pid_t *pids = calloc(njobs, sizeof(pid_t));
+  unsigned i;
+  for(i = 0; i < njobs; ++i) {
+    if((pids[i] = fork()) == 0) {
+      char fname[PATH_MAX];
+      snprintf(fname, sizeof(fname), "%s.%u", out_fname, i);
+      // Children explore different inputs
+      _exit(fuzz(&c, seed_mix(seed, i), iters, secs, maxn, fname));
+    }
+    if(pids[i] < 0) {
+      fprintf(stderr, "sortcheck-fuzz: fork failed (errno %d)\n", errno);
+      njobs = i;
+      break;
+    }
+  }
+
+  // Stop all jobs once one of them has found an error
+  int found_error = 0;
+  unsigned nrunning;
+  for(nrunning = njobs; nrunning > 0; --nrunning) {
+    int status;
+    pid_t pid = wait(&status);
+    if(pid < 0)
+      break;
+    if(!found_error && (!WIFEXITED(status) || WEXITSTATUS(status))) {
+      if(WIFSIGNALED(status))
+        fprintf(stderr, "sortcheck-fuzz: job %d killed by signal %d\n", (int)pid, WTERMSIG(status));
+      found_error = 1;
+      for(i = 0; i < njobs; ++i) {
+        if(pids[i] != pid)
+          kill(pids[i], SIGTERM);
+      }
+    }
+  }
+
+  free(pids);
+  return found_error;
+}
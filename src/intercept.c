@@ -0,0 +1,170 @@
+/*
+ * Copyright 2015-2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <intercept.h>
+#include <bsearch_cache.h>
+#include <lsearch_cache.h>
+#include <cmp_cost.h>
+#include <lint.h>
+#include <sort.h>
+
+typedef void qsort_fun_t(void *data, size_t n, size_t sz, cmp_fun_t cmp);
+typedef int bsd_sort_fun_t(void *data, size_t n, size_t sz, cmp_fun_t cmp);
+typedef void qsort_r_fun_t(void *data, size_t n, size_t sz, cmp_r_fun_t cmp, void *arg);
+
+int call_qsort(void *real, void *data, size_t n, size_t sz, const Comparator *c) {
+  ((qsort_fun_t *)real)(data, n, sz, (cmp_fun_t)c->cmp);
+  return 0;
+}
+
+int call_bsd_sort(void *real, void *data, size_t n, size_t sz, const Comparator *c) {
+  return ((bsd_sort_fun_t *)real)(data, n, sz, (cmp_fun_t)c->cmp);
+}
+
+int call_qsort_r(void *real, void *data, size_t n, size_t sz, const Comparator *c) {
+  ((qsort_r_fun_t *)real)(data, n, sz, (cmp_r_fun_t)c->cmp, c->arg);
+  return 0;
+}
+
+int checked_sort(ErrorContext *ctx, const Comparator *c, void *data, size_t n, size_t sz, int stable, sort_call_t call, void *real) {
+  PROBE_ENTRY(*ctx, n, sz);
+  TraceSpan ts;
+  trace_begin(&ts);
+  int suppress_errors_ = !n || suppress_errors(ctx);
+  if(flags.lint)
+    lint_usage(ctx, n, sz);
+  if(!suppress_errors_)
+    check_sort_input(ctx, c, data, n, sz);
+  if(flags.lint)
+    lint_sort_input(ctx, c, data, n, sz);
+  CmpShim shim;
+  int count_cmp = flags.cmp_cost && ctx->callsite;
+  // Reentrant comparators get reentrant shim
+  Comparator plain_shim = { (void *)cmp_shim, 0, 0 };
+  const Comparator *real_c = c;
+  if(count_cmp) {
+    cmp_shim_begin(&shim, c);
+    real_c = c->is_reentrant ? &shim.shim_c : &plain_shim;
+  }
+  PerfSample ps;
+  trace_real_begin(&ts);
+  perf_begin(&ps);
+  int res = 0;
+  if(flags.replace_sort)
+    sort_array(ctx, count_cmp ? &shim.shim_c : c, data, n, sz, stable, !suppress_errors_);
+  else
+    res = call(real, data, n, sz, real_c);
+  perf_end(ctx, STAGE_REAL, &ps);
+  trace_real_end(&ts);
+  if(count_cmp)
+    cmp_shim_end(ctx, &shim, n, 0, !suppress_errors_ && !ctx->found_error);
+  if(!suppress_errors_)
+    check_sort_output(ctx, c, data, n, sz);
+  trace_end(ctx, &ts, n, sz);
+  PROBE_EXIT(*ctx);
+  return res;
+}
+
+void *checked_bsearch(ErrorContext *ctx, const void *key, const void *data, size_t n, size_t sz, cmp_fun_t cmp, bsearch_fun_t *real) {
+  PROBE_ENTRY(*ctx, n, sz);
+  TraceSpan ts;
+  trace_begin(&ts);
+  Comparator c = { cmp, 0, 0 };
+  int suppress_errors_ = !n || suppress_errors(ctx);
+  if(flags.lint)
+    lint_usage(ctx, n, sz);
+  if(suppress_errors_) {
+    // Skip checks
+  } else if(flags.bsearch_path || (get_budget(ctx) && get_budget(ctx) < n)) {
+    // Logarithmic check
+    check_total_order(ctx, &c, 0, key, data, n, sz);
+    if(get_checks(ctx) & CHECK_SORTED)
+      check_bsearch_path(ctx, &c, key, data, n, sz);
+  } else if(!(flags.bsearch_cache && bsearch_cache_lookup(data, n, sz, cmp))) {
+    check_basic(ctx, &c, 0, key, data, n, sz);
+    check_total_order(ctx, &c, 0, key, data, n, sz);  // manpage does not require this but still
+    check_sorted(ctx, &c, key, data, n, sz);
+    if(flags.bsearch_cache && !ctx->found_error)
+      bsearch_cache_insert(data, n, sz, cmp);
+  }
+  CmpShim shim;
+  int count_cmp = flags.cmp_cost && ctx->callsite;
+  if(count_cmp)
+    cmp_shim_begin(&shim, &c);
+  PerfSample ps;
+  trace_real_begin(&ts);
+  perf_begin(&ps);
+  void *res = real(key, data, n, sz, count_cmp ? cmp_shim : cmp);
+  perf_end(ctx, STAGE_REAL, &ps);
+  trace_real_end(&ts);
+  if(count_cmp)
+    cmp_shim_end(ctx, &shim, n, 1, !suppress_errors_ && !ctx->found_error);
+  trace_end(ctx, &ts, n, sz);
+  PROBE_EXIT(*ctx);
+  return res;
+}
+
+// Check lfind/lsearch call. Tables are usually built by repeated lsearch
+// so elements which were verified in previous calls are only sampled.
+static size_t check_lsearch_input(ErrorContext *ctx, const Comparator *c, const char *key, const void *data, size_t n, size_t sz) {
+  size_t verified = flags.lsearch_cache ? lsearch_cache_lookup(data, n, sz, c->cmp) : 0;
+  if(!verified) {
+    check_basic(ctx, c, 0, key, data, n, sz);
+    check_total_order(ctx, c, 0, key, data, n, sz);
+    return 0;
+  }
+
+  // Key against random segment of verified part...
+  static __thread unsigned ncalls;
+  size_t window = get_window(ctx);
+  size_t len = window < verified ? window : verified;
+  size_t begin = seed_mix((unsigned)(uintptr_t)ctx->ret_addr, ncalls++) % (verified - len + 1);
+  check_basic(ctx, c, 0, key, (const char *)data + begin * sz, len, sz);
+
+  // ... and against new elements
+  if(n > verified)
+    check_basic(ctx, c, 0, key, (const char *)data + verified * sz, n - verified, sz);
+
+  if(get_checks(ctx) & CHECK_GOOD_BSEARCH)
+    check_total_order_tail(ctx, c, data, verified, n, sz);
+
+  return verified;
+}
+
+// Elements appended by lsearch have not been compared with key yet
+// so they are only marked as verified up to old_n.
+static void check_lsearch_output(ErrorContext *ctx, const Comparator *c, const void *data, size_t old_n, size_t n, size_t sz, size_t verified) {
+  // Pairs of verified elements have already been checked
+  size_t begin = verified ? verified - 1 : 0;
+  check_uniqueness(ctx, c, (const char *)data + begin * sz, n - begin, sz);
+  if(flags.lsearch_cache && !ctx->found_error)
+    lsearch_cache_insert(data, old_n, sz, c->cmp);
+}
+
+void *checked_lsearch(ErrorContext *ctx, const void *key, void *data, size_t *n, size_t sz, cmp_fun_t cmp, lsearch_fun_t *real) {
+  PROBE_ENTRY(*ctx, n ? *n : 0, sz);
+  TraceSpan ts;
+  trace_begin(&ts);
+  Comparator c = { cmp, 0, 0 };
+  int suppress_errors_ = !n || suppress_errors(ctx);
+  size_t verified = 0, old_n = n ? *n : 0;
+  if(flags.lint && n)
+    lint_usage(ctx, old_n, sz);
+  if(!suppress_errors_)
+    verified = check_lsearch_input(ctx, &c, key, data, old_n, sz);
+  PerfSample ps;
+  trace_real_begin(&ts);
+  perf_begin(&ps);
+  void *res = real(key, data, n, sz, cmp);
+  perf_end(ctx, STAGE_REAL, &ps);
+  trace_real_end(&ts);
+  if(!suppress_errors_)
+    check_lsearch_output(ctx, &c, data, old_n, *n, sz, verified);
+  trace_end(ctx, &ts, old_n, sz);
+  PROBE_EXIT(*ctx);
+  return res;
+}
@@ -8,6 +8,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <io.h>
 
 char *read_file(const char *fname, size_t *plen) {
@@ -38,3 +41,20 @@ char *read_file(const char *fname, size_t *plen) {
 
   return res;
 }
+
+size_t read_file_to_buf(const char *fname, char *buf, size_t size) {
+  buf[0] = 0;
+
+  int fd = open(fname, O_RDONLY);
+  if(fd < 0)
+    return 0;
+
+  ssize_t len = read(fd, buf, size - 1);
+  close(fd);
+
+  if(len < 0)
+    len = 0;
+  buf[len] = 0;
+
+  return len;
+}
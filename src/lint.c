@@ -0,0 +1,111 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <lint.h>
+#include <checksum.h>
+
+#include <string.h>
+#include <time.h>
+
+// Thresholds for lint=usage
+#define LINEAR_SEARCH_MIN_N 32
+#define SMALL_BSEARCH_MAX_N 8
+#define LARGE_ELEM_MIN_SZ 256
+#define CACHE_LINE 64
+
+void lint_sort_input(ErrorContext *ctx, const Comparator *cmp, const void *data, size_t n, size_t sz) {
+  Callsite *cs = ctx->callsite;
+  if(!cs || !(flags.lint & LINT_REDUNDANT) || n < 2)
+    return;
+
+  // Adjacent pairs (usually stops at first inversion)
+  int sorted = 1;
+  size_t i;
+  for(i = 1; i < n && sorted; ++i) {
+    const char *cur = (const char *)data + i * sz;
+    sorted = cmp_eval(cmp, cur - sz, cur) <= 0;
+  }
+
+  // Hash of full content (fingerprint() only samples
+  // a few elements which is not enough here)
+  uint64_t h = fnv1a(FNV1A_INIT, &n, sizeof(n));
+  h = fnv1a(h, &sz, sizeof(sz));
+  h = hash_words(h, data, n * sz);
+  uint64_t prev = __atomic_exchange_n(&cs->last_input_hash, h, __ATOMIC_RELAXED);
+  int repeated = prev == h;
+
+  __atomic_fetch_add(&cs->nlinted, 1, __ATOMIC_RELAXED);
+  if(sorted)
+    __atomic_fetch_add(&cs->nsorted_input, 1, __ATOMIC_RELAXED);
+  if(repeated)
+    __atomic_fetch_add(&cs->nrepeated_input, 1, __ATOMIC_RELAXED);
+
+  // Estimate cost of (mergesort-like) sort
+  if(sorted || repeated) {
+    uint64_t log_n = log2_ceil(n);
+    __atomic_fetch_add(&cs->wasted_cmp, n * log_n, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&cs->wasted_bytes, n * sz * log_n, __ATOMIC_RELAXED);
+  }
+}
+
+static inline void atomic_max(uint64_t *p, uint64_t val) {
+  uint64_t old = __atomic_load_n(p, __ATOMIC_RELAXED);
+  while(old < val && !__atomic_compare_exchange_n(p, &old, val, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+void lint_usage(ErrorContext *ctx, size_t n, size_t sz) {
+  Callsite *cs = ctx->callsite;
+  if(!cs || !(flags.lint & LINT_USAGE))
+    return;
+
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t now = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+  if(!__atomic_fetch_add(&cs->nused, 1, __ATOMIC_RELAXED)) {
+    cs->func = ctx->func;
+    cs->first_ns = now;
+  }
+  __atomic_store_n(&cs->last_ns, now, __ATOMIC_RELAXED);
+
+  unsigned bucket = n ? 8 * sizeof(unsigned long long) - __builtin_clzll(n) : 0;
+  if(bucket >= SIZE_HIST_BUCKETS)
+    bucket = SIZE_HIST_BUCKETS - 1;
+  __atomic_fetch_add(&cs->n_hist[bucket], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&cs->sum_n, n, __ATOMIC_RELAXED);
+  atomic_max(&cs->max_n, n);
+  if(sz > cs->max_sz)
+    cs->max_sz = sz;  // Racy but ok
+
+  // Estimate work which better algorithm would save
+  // (moved bytes are converted to comparisons at cache line granularity)
+  unsigned issue = 0;
+  uint64_t waste = 0, log_n = log2_ceil(n);
+  if(0 == strcmp(ctx->func, "lfind") || 0 == strcmp(ctx->func, "lsearch")) {
+    // Average linear scan vs. binary search
+    if(n >= LINEAR_SEARCH_MIN_N) {
+      issue = USAGE_LINEAR_SEARCH;
+      waste = n / 2 - (log_n + 1);
+    }
+  } else if(0 == strcmp(ctx->func, "bsearch")) {
+    // All indirect calls could be avoided by inline scan
+    if(n && n <= SMALL_BSEARCH_MAX_N) {
+      issue = USAGE_SMALL_BSEARCH;
+      waste = log_n + 1;
+    }
+  } else if(sz >= LARGE_ELEM_MIN_SZ) {
+    // Moving elements vs. moving pointers to them
+    issue = USAGE_LARGE_ELEMS;
+    waste = (uint64_t)n * log_n * (sz - sizeof(void *)) / CACHE_LINE;
+  }
+
+  if(issue) {
+    __atomic_fetch_or(&cs->issues, issue, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&cs->usage_waste, waste, __ATOMIC_RELAXED);
+  }
+}
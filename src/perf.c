@@ -0,0 +1,170 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <perf.h>
+
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char *const perf_counter_names[NUM_PERF_COUNTERS] = {
+  "cycles",
+  "instructions",
+  "llc-misses",
+  "branch-misses",
+};
+
+static unsigned available;
+
+#ifdef __linux__
+
+static const uint64_t configs[NUM_PERF_COUNTERS] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES,
+  PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+typedef struct {
+  int opened;  // Reset in forked children so that counters are reopened
+  int has_fds;
+  int fd[NUM_PERF_COUNTERS];
+  struct perf_event_mmap_page *pc[NUM_PERF_COUNTERS];
+} ThreadCounters;
+
+static __thread ThreadCounters tc;
+
+// Destructor of this key releases counters at thread exit
+static pthread_key_t tc_key;
+static pthread_once_t tc_key_once = PTHREAD_ONCE_INIT;
+
+// Counters of parent thread are useless in child
+static void reset_after_fork(void) {
+  tc.opened = 0;
+}
+
+static void close_counters(void) {
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  int i;
+  for(i = 0; i < NUM_PERF_COUNTERS; ++i) {
+    if(tc.pc[i])
+      munmap(tc.pc[i], page_size);
+    if(tc.has_fds && tc.fd[i] >= 0)
+      close(tc.fd[i]);
+    tc.pc[i] = 0;
+    tc.fd[i] = -1;
+  }
+  tc.has_fds = 1;
+}
+
+static void release_counters(void *arg) {
+  (void)arg;
+  close_counters();
+  tc.opened = 0;
+}
+
+static void init_once(void) {
+  pthread_atfork(0, 0, reset_after_fork);
+  pthread_key_create(&tc_key, release_counters);
+}
+
+static void open_counters(void) {
+  pthread_once(&tc_key_once, init_once);
+
+  // Close counters inherited from parent
+  close_counters();
+
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  int i;
+  for(i = 0; i < NUM_PERF_COUNTERS; ++i) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[i];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if(fd < 0)
+      continue;
+    tc.fd[i] = fd;
+
+    // Mapped page allows reading counter via rdpmc without syscall
+    void *pc = mmap(0, page_size, PROT_READ, MAP_SHARED, fd, 0);
+    tc.pc[i] = pc == MAP_FAILED ? 0 : pc;
+
+    __atomic_fetch_or(&available, 1u << i, __ATOMIC_RELAXED);
+  }
+
+  tc.opened = 1;
+  pthread_setspecific(tc_key, &tc);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t rdpmc(unsigned idx) {
+  unsigned lo, hi;
+  __asm__ __volatile__("rdpmc" : "=a"(lo), "=d"(hi) : "c"(idx));
+  return lo | ((uint64_t)hi << 32);
+}
+#endif
+
+// Read counter via rdpmc if kernel allows it
+static int read_mapped(const struct perf_event_mmap_page *pc, uint64_t *val) {
+#if defined(__x86_64__) || defined(__i386__)
+  uint32_t seq;
+  do {
+    seq = __atomic_load_n(&pc->lock, __ATOMIC_ACQUIRE);
+    uint32_t idx = pc->index;
+    if(!pc->cap_user_rdpmc || !idx)
+      return 0;
+    int64_t count = rdpmc(idx - 1);
+    unsigned shift = 64 - pc->pmc_width;
+    count = (int64_t)((uint64_t)count << shift) >> shift;
+    *val = pc->offset + count;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while(__atomic_load_n(&pc->lock, __ATOMIC_RELAXED) != seq);
+  return 1;
+#else
+  (void)pc;
+  (void)val;
+  return 0;
+#endif
+}
+
+void perf_read(PerfSample *s) {
+  if(!tc.opened)
+    open_counters();
+
+  int i;
+  for(i = 0; i < NUM_PERF_COUNTERS; ++i) {
+    uint64_t val = 0;
+    if(tc.fd[i] >= 0
+        && !(tc.pc[i] && read_mapped(tc.pc[i], &val))
+        && read(tc.fd[i], &val, sizeof(val)) != sizeof(val))
+      val = 0;
+    s->val[i] = val;
+  }
+}
+
+#else
+
+void perf_read(PerfSample *s) {
+  memset(s, 0, sizeof(*s));
+}
+
+#endif
+
+unsigned perf_available(void) {
+  return available;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <perm.h>
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+// Murmur3 finalizer
+static inline uint32_t fmix32(uint32_t h) {
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+unsigned seed_mix(unsigned seed, uint64_t x) {
+  return fmix32(seed ^ fmix32((uint32_t)x ^ fmix32((uint32_t)(x >> 32) + 0x9e3779b9u)));
+}
+
+void perm_init(Perm *p, size_t n, unsigned seed) {
+  p->n = n;
+
+  // Domain is [0, 2^(2 * half_bits)) so that
+  // cycle walking needs at most 4 iterations on average
+  unsigned bits = 0;
+  while(bits < 64 && ((uint64_t)1 << bits) < n)
+    ++bits;
+  p->half_bits = bits < 2 ? 1 : (bits + 1) / 2;
+  p->half_mask = ((uint64_t)1 << p->half_bits) - 1;
+
+  size_t i;
+  for(i = 0; i < ARRAY_SIZE(p->keys); ++i) {
+    seed = fmix32(seed + 0x9e3779b9u * (unsigned)(i + 1));
+    p->keys[i] = seed;
+  }
+}
+
+static inline uint64_t round_fun(uint64_t x, uint32_t key) {
+  return fmix32((uint32_t)x ^ (uint32_t)(x >> 32) ^ key)
+         ^ ((uint64_t)fmix32((uint32_t)(x >> 32) + key) << 32);
+}
+
+static uint64_t encrypt(const Perm *p, uint64_t x) {
+  uint64_t l = x >> p->half_bits, r = x & p->half_mask;
+  size_t i;
+  for(i = 0; i < ARRAY_SIZE(p->keys); ++i) {
+    uint64_t tmp = r;
+    r = (l ^ round_fun(r, p->keys[i])) & p->half_mask;
+    l = tmp;
+  }
+  return (l << p->half_bits) | r;
+}
+
+size_t perm_apply(const Perm *p, size_t i) {
+  uint64_t x = i;
+  // Cycle walking: encryption is a bijection over the whole domain
+  // so iterating it keeps us inside [0, n) bijectively
+  do
+    x = encrypt(p, x);
+  while(x >= p->n);
+  return (size_t)x;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <pool.h>
+#include <platform.h>
+
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define MAX_THREADS 64
+
+enum { POOL_NONE, POOL_READY, POOL_DISABLED };
+
+static int pool_state = POOL_NONE;
+static pid_t pool_pid;
+
+static pthread_mutex_t pool_init_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Serializes users of the pool
+static pthread_mutex_t pool_owner = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cv = PTHREAD_COND_INITIALIZER;
+
+// Current job (protected by lock, except for next)
+static struct {
+  task_fun_t fun;
+  void *arg;
+  size_t n, chunk;
+  size_t next;  // First unclaimed index
+  unsigned active;  // Number of threads working on the job
+  unsigned gen;
+} job;
+
+// Threads grab chunks until the range is exhausted
+// so faster threads automatically take over work of slower ones.
+static void run_chunks(void) {
+  while(1) {
+    size_t begin = __atomic_fetch_add(&job.next, job.chunk, __ATOMIC_RELAXED);
+    if(begin >= job.n)
+      break;
+    size_t end = begin + job.chunk < job.n ? begin + job.chunk : job.n;
+    job.fun(job.arg, begin, end);
+  }
+}
+
+static void *worker(void *p) {
+  (void)p;
+  unsigned seen_gen = 0;
+
+  pthread_mutex_lock(&lock);
+  while(1) {
+    while(job.gen == seen_gen)
+      pthread_cond_wait(&work_cv, &lock);
+    seen_gen = job.gen;
+
+    // Do not join jobs which are already fully distributed
+    // (their owner may have returned already)
+    if(__atomic_load_n(&job.next, __ATOMIC_RELAXED) >= job.n)
+      continue;
+
+    ++job.active;
+    pthread_mutex_unlock(&lock);
+
+    run_chunks();
+
+    pthread_mutex_lock(&lock);
+    if(--job.active == 0)
+      pthread_cond_broadcast(&done_cv);
+  }
+
+  return 0;
+}
+
+// Threads do not survive fork
+static void disable_in_child(void) {
+  pool_state = POOL_DISABLED;
+}
+
+static int start_pool(unsigned nthreads) {
+  pthread_mutex_lock(&pool_init_lock);
+
+  if(pool_state == POOL_NONE) {
+    pool_state = POOL_DISABLED;
+
+    pthread_atfork(0, 0, disable_in_child);
+
+    // Workers should not receive user's signals
+    // (except synchronous faults used by page protection)
+    sigset_t all, old;
+    sigfillset(&all);
+    sigdelset(&all, SIGSEGV);
+    sigdelset(&all, SIGBUS);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+
+    unsigned i, nstarted = 0;
+    for(i = 1; i < nthreads && i < MAX_THREADS; ++i) {
+      pthread_t t;
+      if(0 != pthread_create(&t, 0, worker, 0))
+        break;
+      pthread_detach(t);
+      ++nstarted;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old, 0);
+
+    if(nstarted) {
+      pool_pid = getpid();
+      barrier();
+      pool_state = POOL_READY;
+    }
+  }
+
+  pthread_mutex_unlock(&pool_init_lock);
+
+  return pool_state == POOL_READY;
+}
+
+void pool_run(unsigned nthreads, task_fun_t fun, void *arg, size_t n, size_t chunk) {
+  if(!chunk)
+    chunk = 1;
+
+  int parallel = nthreads > 1 && n > chunk
+    && pool_state != POOL_DISABLED
+    && (pool_state == POOL_READY || start_pool(nthreads))
+    && pool_pid == getpid()
+    // Pool may be busy (e.g. due to nested sort in comparator)
+    && 0 == pthread_mutex_trylock(&pool_owner);
+
+  if(!parallel) {
+    fun(arg, 0, n);
+    return;
+  }
+
+  pthread_mutex_lock(&lock);
+  job.fun = fun;
+  job.arg = arg;
+  job.n = n;
+  job.chunk = chunk;
+  job.next = 0;
+  job.active = 1;
+  ++job.gen;
+  pthread_cond_broadcast(&work_cv);
+  pthread_mutex_unlock(&lock);
+
+  run_chunks();
+
+  pthread_mutex_lock(&lock);
+  --job.active;
+  while(job.active)
+    pthread_cond_wait(&done_cv, &lock);
+  pthread_mutex_unlock(&lock);
+
+  pthread_mutex_unlock(&pool_owner);
+}
@@ -16,6 +16,11 @@
 #include <errno.h>
 
 #include <libgen.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 static char *read_field(char **p) {
   // Skip leading whites
@@ -65,7 +70,7 @@ ProcMap *get_proc_maps(size_t *n) {
     char *cur = dash + 1;
     char *end_addr = read_field(&cur);
     assert(end_addr);
-    /*char *perms = */read_field(&cur);
+    char *perms = read_field(&cur);
     /*char *offset = */read_field(&cur);
     /*char *dev = */read_field(&cur);
     /*char *inode = */read_field(&cur);
@@ -79,6 +84,7 @@ ProcMap *get_proc_maps(size_t *n) {
     } else {
       maps[i].begin_addr = (const void *)strtoull(begin_addr, 0, 16);
       maps[i].end_addr = (const void *)strtoull(end_addr, 0, 16);
+      maps[i].readable = perms[0] == 'r';
       strncpy(&maps[i].name[0], name, sizeof(maps[i].name));  // Hey, sizeof on arrays work!
       maps[i].name[sizeof(maps[i].name) - 1] = 0;  // Ugly...
       if(++i >= max_maps) {
@@ -118,11 +124,27 @@ void get_proc_cmdline(char **pname, char **pcmdline) {
   *pcmdline = cmdline;
 }
 
+// Maps are sorted by address so use binary search
+// (hand-written to avoid going through bsearch interceptor)
 const ProcMap *find_proc_map_for_addr(const ProcMap *maps, size_t n, const void *addr) {
-  size_t i;
-  for(i = 0; i < n; ++i)
-    if(maps[i].begin_addr <= addr && addr < maps[i].end_addr)
-      return &maps[i];
+  size_t lo = 0, hi = n;
+  while(lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if(addr < maps[mid].begin_addr)
+      hi = mid;
+    else if(addr >= maps[mid].end_addr)
+      lo = mid + 1;
+    else
+      return &maps[mid];
+  }
   return NULL;
 }
 
+
+unsigned long get_thread_id(void) {
+#ifdef __linux__
+  return syscall(SYS_gettid);
+#else
+  return (unsigned long)pthread_self();
+#endif
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <protect.h>
+#include <backtrace.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <signal.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static pthread_mutex_t protect_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Protected range may span several mappings with different permissions
+#define MAX_PROT_RANGES 8
+
+typedef struct {
+  char *begin, *end;
+  int prot;  // Original protection
+} ProtRange;
+
+// Currently protected range (read by signal handler)
+static char *volatile prot_begin, *volatile prot_end;
+static volatile int prot_active, prot_fault;
+static ProtRange prot_ranges[MAX_PROT_RANGES];
+static size_t nprot_ranges;
+
+static struct sigaction old_segv, old_bus;
+
+// Restore original permissions (async-signal-safe)
+static void restore_ranges(void) {
+  size_t i;
+  for(i = 0; i < nprot_ranges; ++i)
+    mprotect(prot_ranges[i].begin, prot_ranges[i].end - prot_ranges[i].begin, prot_ranges[i].prot);
+}
+
+static void fault_handler(int sig, siginfo_t *info, void *uctx) {
+  char *addr = info->si_addr;
+  if(prot_active && prot_begin <= addr && addr < prot_end) {
+    // Write from comparator: make range writable
+    // so that faulting instruction can be restarted
+    restore_ranges();
+    prot_active = 0;
+    prot_fault = 1;
+    return;
+  }
+
+  // Not ours, chain to previous handler
+  const struct sigaction *old = sig == SIGSEGV ? &old_segv : &old_bus;
+  if(old->sa_flags & SA_SIGINFO) {
+    old->sa_sigaction(sig, info, uctx);
+  } else if(old->sa_handler == SIG_DFL || old->sa_handler == SIG_IGN) {
+    // Reinstate previous disposition and let the fault repeat
+    // (handler is installed again on next protect_begin)
+    sigaction(sig, old, 0);
+  } else {
+    old->sa_handler(sig);
+  }
+}
+
+// Collect original permissions of mappings which cover [begin, end)
+static int get_range_prots(char *begin, char *end) {
+  nprot_ranges = 0;
+#ifdef __linux__
+  FILE *f = fopen("/proc/self/maps", "r");
+  if(!f)
+    return 0;
+
+  char *covered = begin;
+  char buf[512];
+  while(covered < end && fgets(buf, sizeof(buf), f)) {
+    // Lines may be longer than buffer (long file names)
+    if(!strchr(buf, '\n')) {
+      int c;
+      while((c = fgetc(f)) != EOF && c != '\n')
+        ;
+    }
+
+    unsigned long lo, hi;
+    char perms[5];
+    if(3 != sscanf(buf, "%lx-%lx %4s", &lo, &hi, perms))
+      continue;
+    if((char *)hi <= covered)
+      continue;
+    // Range must be fully mapped
+    if((char *)lo > covered || nprot_ranges == MAX_PROT_RANGES)
+      break;
+
+    ProtRange *r = &prot_ranges[nprot_ranges++];
+    r->begin = covered;
+    r->end = (char *)hi < end ? (char *)hi : end;
+    r->prot = (perms[0] == 'r' ? PROT_READ : 0)
+              | (perms[1] == 'w' ? PROT_WRITE : 0)
+              | (perms[2] == 'x' ? PROT_EXEC : 0);
+    covered = r->end;
+  }
+
+  fclose(f);
+  return covered >= end;
+#else
+  // No portable way to query permissions; array is about to be sorted
+  // in place so it must be writable
+  prot_ranges[0].begin = begin;
+  prot_ranges[0].end = end;
+  prot_ranges[0].prot = PROT_READ | PROT_WRITE;
+  nprot_ranges = 1;
+  return 1;
+#endif
+}
+
+static int install_handler(int sig, struct sigaction *old) {
+  struct sigaction cur;
+  if(0 != sigaction(sig, 0, &cur))
+    return 0;
+
+  // Application may have overridden our handler
+  if((cur.sa_flags & SA_SIGINFO) && cur.sa_sigaction == fault_handler)
+    return 1;
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = fault_handler;
+  sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+  sigemptyset(&sa.sa_mask);
+  return 0 == sigaction(sig, &sa, old);
+}
+
+int protect_begin(void *data, size_t size, char **pbegin, char **pend) {
+  uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+  uintptr_t begin = ((uintptr_t)data + page_size - 1) & ~(page_size - 1);
+  uintptr_t end = ((uintptr_t)data + size) & ~(page_size - 1);
+  if(begin >= end)
+    return 0;
+
+  // Writes to our own stack can't be intercepted
+  // (kernel would fail to push signal frame)
+  const void *stack_lo, *stack_hi;
+  if(!get_stack_bounds(&stack_lo, &stack_hi)
+      || (begin < (uintptr_t)stack_hi && (uintptr_t)stack_lo < end))
+    return 0;
+
+  if(0 != pthread_mutex_trylock(&protect_lock))
+    return 0;
+
+  if(!install_handler(SIGSEGV, &old_segv) || !install_handler(SIGBUS, &old_bus)) {
+    pthread_mutex_unlock(&protect_lock);
+    return 0;
+  }
+
+  if(!get_range_prots((char *)begin, (char *)end)) {
+    pthread_mutex_unlock(&protect_lock);
+    return 0;
+  }
+
+  prot_begin = (char *)begin;
+  prot_end = (char *)end;
+  prot_fault = 0;
+  prot_active = 1;
+
+  // Only drop write permission
+  size_t i;
+  for(i = 0; i < nprot_ranges; ++i) {
+    const ProtRange *r = &prot_ranges[i];
+    if(0 != mprotect(r->begin, r->end - r->begin, r->prot & ~PROT_WRITE)) {
+      prot_active = 0;
+      restore_ranges();
+      pthread_mutex_unlock(&protect_lock);
+      return 0;
+    }
+  }
+
+  *pbegin = (char *)begin;
+  *pend = (char *)end;
+  return 1;
+}
+
+int protect_end(void) {
+  if(prot_active) {
+    prot_active = 0;
+    restore_ranges();
+  }
+  int fault = prot_fault;
+  pthread_mutex_unlock(&protect_lock);
+  return fault;
+}
@@ -0,0 +1,329 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Offline analysis of counterexamples saved via dump_dir=DIR:
+// loads comparator from module, re-runs checks on dumped elements
+// and exhaustively searches for minimal violations of ordering axioms
+// (which is too expensive to do in production).
+
+#include <checker.h>
+#include <dump.h>
+#include <pool.h>
+#include <resolve.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <unistd.h>
+
+static void usage(const char *prog) {
+  printf("\
+Usage: %s [OPTION]... DUMP\n\
+Analyze counterexample saved by sortcheck (dump_dir option):\n\
+re-run checks on dumped elements and exhaustively search\n\
+for minimal violations of ordering axioms.\n\
+\n\
+Options:\n\
+  -m MODULE  Load comparator from MODULE instead of path in dump\n\
+             (e.g. local copy of production library).\n\
+  -s SYMBOL  Comparator symbol or hex offset (default is offset in dump).\n\
+  -O OPTS    Options for re-run of checks (default is options in dump).\n\
+  -j JOBS    Number of threads for exhaustive search (default 1).\n\
+  -o FILE    Save elements of minimal counterexample to FILE\n\
+             (can be used as seed corpus for sortcheck-fuzz).\n\
+  -h         Print this help and exit.\n\
+", prog);
+}
+
+typedef struct {
+  const Comparator *cmp;
+  const char *data;
+  size_t n, sz;
+  int8_t *matrix;
+  size_t nunstable;
+  // Intransitive triples starting at each row
+  size_t *row_count;
+  size_t (*row_first)[2];
+} Analysis;
+
+#define M(t, i, j) (t)->matrix[(i) * (t)->n + (j)]
+#define ELEM(t, i) ((t)->data + (i) * (t)->sz)
+
+static void eval_rows(void *arg, size_t begin, size_t end) {
+  Analysis *t = arg;
+  size_t i, j, nunstable = 0;
+  for(i = begin; i < end; ++i)
+  for(j = 0; j < t->n; ++j) {
+    int res = sign(cmp_eval(t->cmp, ELEM(t, i), ELEM(t, j)));
+    M(t, i, j) = res;
+    if(res != sign(cmp_eval(t->cmp, ELEM(t, i), ELEM(t, j))))
+      ++nunstable;
+  }
+  __atomic_fetch_add(&t->nunstable, nunstable, __ATOMIC_RELAXED);
+}
+
+// For a <= b and b <= c strict weak order requires a <= c
+// and a == c only if a == b == c.
+static void find_intransitive(void *arg, size_t begin, size_t end) {
+  Analysis *t = arg;
+  size_t i, j, k;
+  for(i = begin; i < end; ++i) {
+    size_t count = 0;
+    for(j = 0; j < t->n; ++j) {
+      if(j == i || M(t, i, j) > 0)
+        continue;
+      for(k = 0; k < t->n; ++k) {
+        if(k == i || k == j || M(t, j, k) > 0)
+          continue;
+        int expected = M(t, i, j) == 0 && M(t, j, k) == 0 ? 0 : -1;
+        if(M(t, i, k) != expected && !count++) {
+          t->row_first[i][0] = j;
+          t->row_first[i][1] = k;
+        }
+      }
+    }
+    t->row_count[i] = count;
+  }
+}
+
+static void print_elem(const Analysis *t, size_t i) {
+  size_t k, len = t->sz < 32 ? t->sz : 32;
+  printf("    #%zu:", i);
+  for(k = 0; k < len; ++k)
+    printf(" %02x", (unsigned char)ELEM(t, i)[k]);
+  printf("%s\n", len < t->sz ? " ..." : "");
+}
+
+static void save_elems(const Analysis *t, const char *fname, const size_t *idx, size_t n) {
+  FILE *f = fopen(fname, "wb");
+  size_t i;
+  for(i = 0; f && i < n; ++i) {
+    if(1 != fwrite(ELEM(t, idx[i]), t->sz, 1, f))
+      break;
+  }
+  if(!f || i < n || fclose(f)) {
+    fprintf(stderr, "sortcheck-replay: failed to write %s\n", fname);
+    exit(1);
+  }
+  printf("minimal counterexample (%zu elements) saved to %s\n", n, fname);
+}
+
+static void *xmalloc(size_t size) {
+  void *p = malloc(size);
+  if(!p && size) {
+    fprintf(stderr, "sortcheck-replay: failed to allocate %zu bytes\n", size);
+    exit(1);
+  }
+  return p;
+}
+
+// Returns non-zero if elements are sorted
+// (uniqueness check is meaningless otherwise)
+static int is_sorted(const Comparator *cmp, const char *data, size_t n, size_t sz) {
+  size_t i;
+  for(i = 1; i < n; ++i) {
+    if(cmp_eval(cmp, data + (i - 1) * sz, data + i * sz) > 0)
+      return 0;
+  }
+  return 1;
+}
+
+// Returns number of found violations
+static size_t analyze(Analysis *t, unsigned njobs, const char *out_fname) {
+  size_t n = t->n, i, j;
+  // Number of elements is limited by DUMP_MAX_ELEMS so no overflow
+  t->matrix = xmalloc(n * n);
+  pool_run(njobs, eval_rows, t, n, 1);
+
+  size_t witness[3], nwitness = 0, nviolations = 0;
+
+  if(t->nunstable) {
+    printf("unstable results: %zu comparison(s)\n", t->nunstable);
+    nviolations += t->nunstable;
+  }
+
+  size_t nreflexive = 0;
+  for(i = 0; i < n; ++i) {
+    if(M(t, i, i) && !nreflexive++) {
+      printf("not reflexive: cmp(#%zu, #%zu) = %d\n", i, i, M(t, i, i));
+      print_elem(t, i);
+      witness[0] = i;
+      nwitness = 1;
+    }
+  }
+  if(nreflexive > 1)
+    printf("  (%zu element(s) in total)\n", nreflexive);
+  nviolations += nreflexive;
+
+  size_t nasym = 0;
+  for(i = 0; i < n; ++i)
+  for(j = 0; j < i; ++j) {
+    if(M(t, i, j) != -M(t, j, i) && !nasym++) {
+      printf("not symmetric: cmp(#%zu, #%zu) = %d, cmp(#%zu, #%zu) = %d\n", j, i, M(t, j, i), i, j, M(t, i, j));
+      print_elem(t, j);
+      print_elem(t, i);
+      witness[0] = j;
+      witness[1] = i;
+      nwitness = 2;
+    }
+  }
+  if(nasym > 1)
+    printf("  (%zu pair(s) in total)\n", nasym);
+  nviolations += nasym;
+
+  t->row_count = xmalloc(n * sizeof(size_t));
+  t->row_first = xmalloc(n * sizeof(t->row_first[0]));
+  pool_run(njobs, find_intransitive, t, n, 1);
+  size_t ntrans = 0;
+  for(i = 0; i < n; ++i) {
+    if(t->row_count[i] && !ntrans) {
+      size_t a = i, b = t->row_first[i][0], c = t->row_first[i][1];
+      printf("not transitive: cmp(#%zu, #%zu) = %d, cmp(#%zu, #%zu) = %d, cmp(#%zu, #%zu) = %d\n",
+             a, b, M(t, a, b), b, c, M(t, b, c), a, c, M(t, a, c));
+      print_elem(t, a);
+      print_elem(t, b);
+      print_elem(t, c);
+      // Prefer smaller counterexamples
+      if(!nwitness) {
+        witness[0] = a;
+        witness[1] = b;
+        witness[2] = c;
+        nwitness = 3;
+      }
+    }
+    ntrans += t->row_count[i];
+  }
+  if(ntrans > 1)
+    printf("  (%zu triple(s) in total)\n", ntrans);
+  nviolations += ntrans;
+
+  if(!nviolations)
+    printf("no violations of ordering axioms found in %zu elements\n", n);
+  else if(out_fname && nwitness)
+    save_elems(t, out_fname, witness, nwitness);
+
+  free(t->matrix);
+  free(t->row_count);
+  free(t->row_first);
+  return nviolations;
+}
+
+int main(int argc, char *argv[]) {
+  const char *module = 0, *sym = 0, *opts = 0, *out_fname = 0;
+  unsigned njobs = 1;
+
+  int opt;
+  while((opt = getopt(argc, argv, "m:s:O:j:o:h")) != -1) {
+    switch(opt) {
+    case 'm':
+      module = optarg;
+      break;
+    case 's':
+      sym = optarg;
+      break;
+    case 'O':
+      opts = optarg;
+      break;
+    case 'j':
+      njobs = atoi(optarg);
+      break;
+    case 'o':
+      out_fname = optarg;
+      break;
+    case 'h':
+      usage(argv[0]);
+      return 0;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if(optind + 1 != argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  Dump d;
+  if(!read_dump(argv[optind], &d)) {
+    fprintf(stderr, "sortcheck-replay: failed to read dump %s\n", argv[optind]);
+    return 1;
+  }
+  const DumpHeader *h = &d.hdr;
+
+  printf("%s: %s\n", d.func, d.msg);
+  printf("  comparison function %s+0x%llx%s\n", d.module, (unsigned long long)h->cmp_offset, h->is_reentrant ? " (qsort_r-style)" : "");
+  printf("  %llu of %llu elements of size %llu, pid %u\n", (unsigned long long)h->n, (unsigned long long)h->orig_n, (unsigned long long)h->sz, h->pid);
+  printf("  options \"%s\"\n", d.opts);
+  if(d.key) {
+    size_t k, len = h->sz < 32 ? h->sz : 32;
+    printf("  key:");
+    for(k = 0; k < len; ++k)
+      printf(" %02x", (unsigned char)d.key[k]);
+    printf("%s\n", len < h->sz ? " ..." : "");
+  }
+
+  // Options of dumped process (without output settings)
+  char *opts_buf = strdup(opts ? opts : d.opts);
+  if(!parse_flags(opts_buf, &flags))
+    return 1;
+  flags.dump_dir = 0;
+  flags.out_filename = 0;
+  flags.print_to_syslog = 0;
+  out = stdout;
+
+  if(h->is_reentrant)
+    fprintf(stderr, "sortcheck-replay: warning: comparator takes additional argument which is not available offline\n");
+
+  char offset[32];
+  snprintf(offset, sizeof(offset), "0x%llx", (unsigned long long)h->cmp_offset);
+
+  Comparator c;
+  c.cmp = resolve_cmp("sortcheck-replay", module ? module : d.module, sym ? sym : offset);
+  c.arg = 0;
+  c.is_reentrant = h->is_reentrant;
+  if(!c.cmp)
+    return 1;
+
+  // Re-run checks which are done in production
+  size_t n = h->n, sz = h->sz, i;
+  char *data = xmalloc(n * sz);
+  memcpy(data, d.data, n * sz);
+  size_t *idx = xmalloc(n * sizeof(size_t));
+  for(i = 0; i < n; ++i)
+    idx[i] = i;
+
+  ErrorContext ctx = { .func = "replay", .cmp_addr = c.cmp, .ret_addr = __builtin_return_address(0) };
+  ctx.cmp_module = module ? module : d.module;
+  ctx.cmp_offset = h->cmp_offset;
+  ctx.caller_module = "<replay>";
+  check_basic(&ctx, &c, 0, d.key, data, n, sz);
+  if(!ctx.found_error)
+    check_window(&ctx, &c, data, sz, idx, n);
+  if(!ctx.found_error && d.key)
+    check_sorted(&ctx, &c, d.key, data, n, sz);
+  // Dumped window of unsorted array is not sorted either
+  if(!ctx.found_error && is_sorted(&c, data, n, sz))
+    check_uniqueness(&ctx, &c, data, n, sz);
+  printf("%s\n", ctx.found_error ? "error reproduced" : "error not reproduced by checks");
+
+  Analysis t;
+  memset(&t, 0, sizeof(t));
+  t.cmp = &c;
+  t.data = d.data;
+  t.n = n;
+  t.sz = sz;
+  size_t nviolations = analyze(&t, njobs, out_fname);
+
+  free(idx);
+  free(data);
+  free(opts_buf);
+  free_dump(&d);
+  return ctx.found_error || nviolations;
+}
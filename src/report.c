@@ -0,0 +1,400 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Offline aggregator of SortChecker reports: collects warnings
+// from logs of many processes, merges duplicates
+// and symbolizes them.
+
+#include <symbolizer.h>
+#include <checksum.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <unistd.h>
+
+#define MAX_CALLERS 4
+#define MAX_PROCS 4
+
+typedef struct {
+  char module[256];
+  size_t offset;
+} Location;
+
+typedef struct {
+  char func[32];
+  char msg[128];
+  Location cmp;
+  Location callers[MAX_CALLERS];
+  size_t ncallers;
+  char procs[MAX_PROCS][64];
+  size_t nprocs;
+  int more_procs;
+  size_t nreports;
+  size_t npids;
+} Finding;
+
+static Finding *findings;
+static size_t nfindings, findings_capacity;
+
+static int symbolize_addrs = 1;
+
+// Pids are only used to count distinct processes
+typedef struct {
+  size_t finding;
+  char proc[64];
+  long pid;
+} ProcKey;
+
+static ProcKey *proc_keys;
+static size_t nproc_keys, proc_keys_capacity;
+
+// Open-addressing hash indices into findings and proc_keys
+// (slots hold index + 1, 0 marks empty slot)
+typedef struct {
+  size_t *slots;
+  size_t size;  // Power of 2
+} Index;
+
+static Index findings_index, proc_keys_index;
+
+static uint64_t hash_finding(const Finding *f) {
+  uint64_t h = FNV1A_INIT;
+  h = fnv1a(h, f->func, strlen(f->func) + 1);
+  h = fnv1a(h, f->msg, strlen(f->msg) + 1);
+  h = fnv1a(h, f->cmp.module, strlen(f->cmp.module) + 1);
+  return fnv1a(h, &f->cmp.offset, sizeof(f->cmp.offset));
+}
+
+static uint64_t hash_proc_key(const ProcKey *k) {
+  uint64_t h = FNV1A_INIT;
+  h = fnv1a(h, &k->finding, sizeof(k->finding));
+  h = fnv1a(h, k->proc, strlen(k->proc) + 1);
+  return fnv1a(h, &k->pid, sizeof(k->pid));
+}
+
+static int same_finding(const Finding *a, const Finding *b) {
+  return 0 == strcmp(a->func, b->func)
+    && 0 == strcmp(a->msg, b->msg)
+    && 0 == strcmp(a->cmp.module, b->cmp.module)
+    && a->cmp.offset == b->cmp.offset;
+}
+
+static int same_proc_key(const ProcKey *a, const ProcKey *b) {
+  return a->finding == b->finding
+    && a->pid == b->pid
+    && 0 == strcmp(a->proc, b->proc);
+}
+
+static void *check_alloc(void *p) {
+  if(!p) {
+    fprintf(stderr, "sortcheck-report: out of memory\n");
+    exit(1);
+  }
+  return p;
+}
+
+// Returns slot which holds matching element or empty slot
+// where it should be inserted
+static size_t *find_slot(const Index *idx, uint64_t h,
+                         int (*same)(const void *, size_t),
+                         const void *key) {
+  size_t mask = idx->size - 1, i;
+  for(i = h & mask; idx->slots[i]; i = (i + 1) & mask) {
+    if(same(key, idx->slots[i] - 1))
+      break;
+  }
+  return &idx->slots[i];
+}
+
+// Grow index so that it stays at most half full after insertion of n-th element
+static void reserve_index(Index *idx, size_t n,
+                          uint64_t (*hash)(size_t)) {
+  if(2 * n <= idx->size)
+    return;
+  size_t old_size = idx->size, *old_slots = idx->slots, i;
+  idx->size = old_size ? 2 * old_size : 128;
+  idx->slots = check_alloc(calloc(idx->size, sizeof(size_t)));
+  size_t mask = idx->size - 1;
+  for(i = 0; i < old_size; ++i) {
+    if(!old_slots[i])
+      continue;
+    size_t j = hash(old_slots[i] - 1) & mask;
+    while(idx->slots[j])
+      j = (j + 1) & mask;
+    idx->slots[j] = old_slots[i];
+  }
+  free(old_slots);
+}
+
+static uint64_t hash_finding_at(size_t i) {
+  return hash_finding(&findings[i]);
+}
+
+static uint64_t hash_proc_key_at(size_t i) {
+  return hash_proc_key(&proc_keys[i]);
+}
+
+static int finding_at_is(const void *key, size_t i) {
+  return same_finding(key, &findings[i]);
+}
+
+static int proc_key_at_is(const void *key, size_t i) {
+  return same_proc_key(key, &proc_keys[i]);
+}
+
+static void usage(const char *prog) {
+  printf("\
+Usage: %s [OPTION]... [FILE]...\n\
+Aggregate SortChecker reports from FILEs (or stdin) and print\n\
+ranked summary of unique errors.\n\
+\n\
+Options:\n\
+  -S      Do not symbolize addresses.\n\
+  -C DIR  Cache parsed symbol tables of modules in DIR\n\
+          (default $XDG_CACHE_HOME/sortcheck or ~/.cache/sortcheck,\n\
+          empty to disable).\n\
+  -h      Print this help and exit.\n\
+", prog);
+}
+
+// Parse "0x... (module+0x...)"
+static const char *parse_location(const char *p, Location *loc) {
+  const char *open = strchr(p, '(');
+  if(!open)
+    return NULL;
+  const char *plus = strstr(open, "+0x");
+  if(!plus)
+    return NULL;
+  size_t len = plus - open - 1;
+  if(len >= sizeof(loc->module))
+    len = sizeof(loc->module) - 1;
+  memcpy(loc->module, open + 1, len);
+  loc->module[len] = 0;
+  char *end;
+  loc->offset = strtoull(plus + 1, &end, 16);
+  if(*end != ')')
+    return NULL;
+  return end + 1;
+}
+
+static void add_proc(size_t finding, const char *proc, long pid) {
+  ProcKey key;
+  memset(&key, 0, sizeof(key));
+  key.finding = finding;
+  snprintf(key.proc, sizeof(key.proc), "%s", proc);
+  key.pid = pid;
+
+  reserve_index(&proc_keys_index, nproc_keys + 1, hash_proc_key_at);
+  size_t *slot = find_slot(&proc_keys_index, hash_proc_key(&key), proc_key_at_is, &key);
+  if(*slot)
+    return;
+
+  if(nproc_keys >= proc_keys_capacity) {
+    proc_keys_capacity = proc_keys_capacity ? 2 * proc_keys_capacity : 64;
+    proc_keys = check_alloc(realloc(proc_keys, proc_keys_capacity * sizeof(ProcKey)));
+  }
+  proc_keys[nproc_keys++] = key;
+  *slot = nproc_keys;
+
+  size_t i;
+  Finding *f = &findings[finding];
+  ++f->npids;
+  for(i = 0; i < f->nprocs; ++i) {
+    if(0 == strcmp(f->procs[i], proc))
+      return;
+  }
+  if(f->nprocs < MAX_PROCS)
+    snprintf(f->procs[f->nprocs++], sizeof(f->procs[0]), "%s", proc);
+  else
+    f->more_procs = 1;
+}
+
+// Parse line of the form
+//   NAME[PID]: FUNC: MSG (comparison function ADDR (MODULE+OFF), called from ADDR (MODULE+OFF), ...)
+// (possibly prefixed by syslog header)
+static void parse_line(const char *line) {
+  const char *info = strstr(line, " (comparison function ");
+  if(!info)
+    return;
+
+  // Locate "NAME[PID]: " prefix
+  const char *bracket = strstr(line, "]: ");
+  if(!bracket || bracket > info)
+    return;
+  const char *open = bracket;
+  while(open > line && *open != '[')
+    --open;
+  if(*open != '[')
+    return;
+  const char *name = open;
+  while(name > line && name[-1] != ' ')
+    --name;
+
+  char proc[64];
+  snprintf(proc, sizeof(proc), "%.*s", (int)(open - name), name);
+  long pid = atol(open + 1);
+
+  const char *func = bracket + 3;
+  const char *colon = strstr(func, ": ");
+  if(!colon || colon > info)
+    return;
+
+  Finding f;
+  memset(&f, 0, sizeof(f));
+  snprintf(f.func, sizeof(f.func), "%.*s", (int)(colon - func), func);
+
+  // Error messages may include varying details (e.g. index)
+  const char *msg = colon + 2;
+  const char *msg_end = strstr(msg, " at index ");
+  if(!msg_end || msg_end > info)
+    msg_end = info;
+  snprintf(f.msg, sizeof(f.msg), "%.*s", (int)(msg_end - msg), msg);
+
+  const char *p = parse_location(info + strlen(" (comparison function "), &f.cmp);
+  if(!p || 0 != strncmp(p, ", called from ", strlen(", called from ")))
+    return;
+  if(!parse_location(p, &f.callers[0]))
+    return;
+
+  reserve_index(&findings_index, nfindings + 1, hash_finding_at);
+  size_t *slot = find_slot(&findings_index, hash_finding(&f), finding_at_is, &f);
+
+  size_t i;
+  if(!*slot) {
+    if(nfindings >= findings_capacity) {
+      findings_capacity = findings_capacity ? 2 * findings_capacity : 64;
+      findings = check_alloc(realloc(findings, findings_capacity * sizeof(Finding)));
+    }
+    i = nfindings;
+    findings[nfindings++] = f;
+    findings[i].ncallers = 1;
+    *slot = nfindings;
+  } else {
+    i = *slot - 1;
+    Finding *old = &findings[i];
+    size_t j;
+    for(j = 0; j < old->ncallers; ++j) {
+      if(0 == strcmp(old->callers[j].module, f.callers[0].module)
+          && old->callers[j].offset == f.callers[0].offset)
+        break;
+    }
+    if(j == old->ncallers && j < MAX_CALLERS)
+      old->callers[old->ncallers++] = f.callers[0];
+  }
+
+  ++findings[i].nreports;
+  add_proc(i, proc, pid);
+}
+
+static void read_log(FILE *in) {
+  char *line = 0;
+  size_t len = 0;
+  while(-1 != getline(&line, &len, in))
+    parse_line(line);
+  free(line);
+}
+
+static int finding_cmp(const void *pa, const void *pb) {
+  const Finding *a = pa, *b = pb;
+  if(a->npids != b->npids)
+    return a->npids > b->npids ? -1 : 1;
+  if(a->nreports != b->nreports)
+    return a->nreports > b->nreports ? -1 : 1;
+  return strcmp(a->msg, b->msg);
+}
+
+static void print_location(const char *prefix, const Location *loc, int is_ret_addr) {
+  printf("    %s%s+0x%zx", prefix, loc->module, loc->offset);
+  SymbolInfo info;
+  // Return address points to instruction after call
+  if(symbolize_addrs && loc->offset
+      && symbolize(loc->module, loc->offset - (is_ret_addr ? 1 : 0), &info)) {
+    printf(" in %s", info.func ? info.func : "??");
+    if(info.file)
+      printf(" at %s:%u", info.file, info.line);
+  }
+  printf("\n");
+}
+
+// Default location of symbol cache (per XDG spec)
+static const char *default_cache_dir(char *buf, size_t size) {
+  const char *xdg = getenv("XDG_CACHE_HOME"), *home = getenv("HOME");
+  if(xdg && *xdg)
+    snprintf(buf, size, "%s/sortcheck", xdg);
+  else if(home && *home)
+    snprintf(buf, size, "%s/.cache/sortcheck", home);
+  else
+    return NULL;
+  return buf;
+}
+
+int main(int argc, char *argv[]) {
+  char cache_buf[PATH_MAX];
+  const char *cache_dir = default_cache_dir(cache_buf, sizeof(cache_buf));
+
+  int opt;
+  while((opt = getopt(argc, argv, "SC:h")) != -1) {
+    switch(opt) {
+    case 'S':
+      symbolize_addrs = 0;
+      break;
+    case 'C':
+      cache_dir = optarg;
+      break;
+    case 'h':
+      usage(argv[0]);
+      return 0;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  set_symbolizer_cache(cache_dir);
+
+  if(optind == argc)
+    read_log(stdin);
+
+  for(; optind < argc; ++optind) {
+    FILE *in = fopen(argv[optind], "rb");
+    if(!in) {
+      fprintf(stderr, "sortcheck-report: failed to open %s\n", argv[optind]);
+      return 1;
+    }
+    read_log(in);
+    fclose(in);
+  }
+
+  qsort(findings, nfindings, sizeof(Finding), finding_cmp);
+
+  size_t i, j;
+  for(i = 0; i < nfindings; ++i) {
+    const Finding *f = &findings[i];
+    printf("#%zu: %s: %s\n", i + 1, f->func, f->msg);
+    printf("  reported %zu time(s) by %zu process(es) (", f->nreports, f->npids);
+    for(j = 0; j < f->nprocs; ++j)
+      printf("%s%s", j ? ", " : "", f->procs[j]);
+    printf("%s)\n", f->more_procs ? ", ..." : "");
+    print_location("comparison function ", &f->cmp, 0);
+    for(j = 0; j < f->ncallers; ++j)
+      print_location("called from ", &f->callers[j], 1);
+  }
+
+  if(!nfindings)
+    printf("No errors found\n");
+
+  release_symbolizer();
+  free(findings);
+  free(proc_keys);
+  free(findings_index.slots);
+  free(proc_keys_index.slots);
+
+  return 0;
+}
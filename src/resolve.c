@@ -0,0 +1,50 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <resolve.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <dlfcn.h>
+#ifdef __GLIBC__
+#include <link.h>
+#endif
+#include <unistd.h>
+
+void *resolve_cmp(const char *prefix, const char *module, const char *sym) {
+  // Do not search library paths for local files
+  char path[PATH_MAX];
+  if(!strchr(module, '/') && 0 == access(module, F_OK))
+    snprintf(path, sizeof(path), "./%s", module);
+  else
+    snprintf(path, sizeof(path), "%s", module);
+
+  void *h = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if(!h) {
+    // Note that Glibc refuses to load PIE executables
+    fprintf(stderr, "%s: failed to load %s: %s\n", prefix, module, dlerror());
+    return 0;
+  }
+
+  if(0 == strncmp(sym, "0x", 2)) {
+#ifdef __GLIBC__
+    struct link_map *lm;
+    if(0 == dlinfo(h, RTLD_DI_LINKMAP, &lm))
+      return (char *)lm->l_addr + strtoul(sym, 0, 16);
+#endif
+    fprintf(stderr, "%s: failed to get base address of %s\n", prefix, module);
+    return 0;
+  }
+
+  void *cmp = dlsym(h, sym);
+  if(!cmp)
+    fprintf(stderr, "%s: symbol %s not found in %s\n", prefix, sym, module);
+  return cmp;
+}
@@ -0,0 +1,374 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Replacement sort engine (replace_sort=1).
+// Introsort for unstable sorts and bottom-up mergesort
+// for stable ones (merging via small on-stack buffer
+// and rotations for larger runs). No memory is allocated
+// and code is specialized for common element sizes.
+// Consistency of comparator is verified on comparisons which
+// are done by algorithm anyway.
+
+#include <sort.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#define INSERTION_THRESHOLD 16
+
+// Size of on-stack buffer for merging
+#define MERGE_BUF_SIZE 4096
+
+typedef struct {
+  ErrorContext *ctx;
+  const Comparator *cmp;
+  int check;
+  char buf[MERGE_BUF_SIZE];
+} Sorter;
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+static void invariant_error(Sorter *s, const char *msg) {
+  if(s->check && !s->ctx->found_error)
+    report_error(s->ctx, "%s", msg);
+}
+
+static ALWAYS_INLINE int cmp_elems(const Sorter *s, const char *a, const char *b) {
+  return sign(cmp_eval(s->cmp, a, b));
+}
+
+static ALWAYS_INLINE void swap_elems(char *a, char *b, size_t sz) {
+  if(sz == 4) {
+    uint32_t t;
+    memcpy(&t, a, 4);
+    memcpy(a, b, 4);
+    memcpy(b, &t, 4);
+  } else if(sz == 8) {
+    uint64_t t;
+    memcpy(&t, a, 8);
+    memcpy(a, b, 8);
+    memcpy(b, &t, 8);
+  } else {
+    size_t i;
+    for(i = 0; i + 8 <= sz; i += 8) {
+      uint64_t t;
+      memcpy(&t, a + i, 8);
+      memcpy(a + i, b + i, 8);
+      memcpy(b + i, &t, 8);
+    }
+    for(; i < sz; ++i) {
+      char t = a[i];
+      a[i] = b[i];
+      b[i] = t;
+    }
+  }
+}
+
+// Stable insertion sort (via adjacent swaps so no temp element is needed)
+static ALWAYS_INLINE void insertion_sort(Sorter *s, char *base, size_t n, size_t sz) {
+  size_t i, j;
+  for(i = 1; i < n; ++i) {
+    for(j = i; j > 0 && cmp_elems(s, base + (j - 1) * sz, base + j * sz) > 0; --j)
+      swap_elems(base + (j - 1) * sz, base + j * sz, sz);
+  }
+}
+
+static ALWAYS_INLINE void sift_down(Sorter *s, char *base, size_t root, size_t n, size_t sz) {
+  for(;;) {
+    size_t child = 2 * root + 1;
+    if(child >= n)
+      break;
+    if(child + 1 < n && cmp_elems(s, base + child * sz, base + (child + 1) * sz) < 0)
+      ++child;
+    if(cmp_elems(s, base + root * sz, base + child * sz) >= 0)
+      break;
+    swap_elems(base + root * sz, base + child * sz, sz);
+    root = child;
+  }
+}
+
+static ALWAYS_INLINE void heap_sort(Sorter *s, char *base, size_t n, size_t sz) {
+  size_t i;
+  for(i = n / 2; i > 0; --i)
+    sift_down(s, base, i - 1, n, sz);
+  for(i = n; i > 1; --i) {
+    swap_elems(base, base + (i - 1) * sz, sz);
+    sift_down(s, base, 0, i - 1, sz);
+  }
+}
+
+// Move median of first, middle and last elements to lo,
+// smaller one to middle and larger one to last
+// (so that they serve as sentinels for partitioning).
+static ALWAYS_INLINE void select_pivot(Sorter *s, char *base, size_t lo, size_t hi, size_t sz) {
+  char *a = base + lo * sz, *b = base + (lo + (hi - lo) / 2) * sz, *c = base + (hi - 1) * sz;
+
+  // All 3 comparisons are done so that cycles can be detected
+  int ab = cmp_elems(s, a, b), bc = cmp_elems(s, b, c), ac = cmp_elems(s, a, c);
+  int consistent = ab == 0 ? ac == bc
+                   : bc == 0 ? ab == ac
+                   : ac == 0 ? ab == -bc
+                   : !(ab == bc && ac != ab);  // Cycle
+  if(!consistent)
+    invariant_error(s, "comparison function is not transitive");
+
+  // Sort a, b, c
+  if(ab > 0) {
+    swap_elems(a, b, sz);
+    int t = bc;  // Now b contains old a and a contains old b
+    bc = ac;
+    ac = t;
+  }
+  if(bc > 0) {
+    swap_elems(b, c, sz);
+    if(ac > 0)
+      swap_elems(a, b, sz);
+  }
+
+  // Median to lo
+  swap_elems(a, b, sz);
+}
+
+// Hoare partition around pivot at lo; returns final position of pivot.
+static ALWAYS_INLINE size_t partition(Sorter *s, char *base, size_t lo, size_t hi, size_t sz) {
+  select_pivot(s, base, lo, hi, sz);
+  const char *pivot = base + lo * sz;
+
+  size_t i = lo, j = hi;
+  int ri = 0, rj = 0;
+  for(;;) {
+    while(++i < hi && (ri = cmp_elems(s, base + i * sz, pivot)) < 0)
+      ;
+    while(--j > lo && (rj = cmp_elems(s, pivot, base + j * sz)) < 0)
+      ;
+
+    // Sentinels (elements not less and not greater than pivot)
+    // should have stopped the scans
+    if(i == hi || j == lo) {
+      invariant_error(s, "comparison function returns inconsistent results (partition invariant violated)");
+      if(j == lo)
+        break;
+    }
+
+    if(i >= j) {
+      // Both scans stopped at same element so it's both >= and <= pivot
+      if(i == j && ri == rj && ri != 0)
+        invariant_error(s, "comparison function is not symmetric");
+      break;
+    }
+
+    swap_elems(base + i * sz, base + j * sz, sz);
+  }
+
+  swap_elems(base + lo * sz, base + j * sz, sz);
+  return j;
+}
+
+static ALWAYS_INLINE void introsort(Sorter *s, char *base, size_t n, size_t sz) {
+  struct {
+    size_t lo, hi;
+    unsigned depth;
+  } stack[64];
+  size_t top = 0;
+
+  unsigned depth = 0;
+  size_t k;
+  for(k = n; k > 1; k >>= 1)
+    depth += 2;
+
+  size_t lo = 0, hi = n;
+  for(;;) {
+    while(hi - lo > INSERTION_THRESHOLD) {
+      if(!depth) {
+        // Too many bad pivots
+        heap_sort(s, base + lo * sz, hi - lo, sz);
+        lo = hi;
+        break;
+      }
+      --depth;
+
+      // Continue with smaller part so that stack is logarithmic
+      size_t p = partition(s, base, lo, hi, sz);
+      stack[top].depth = depth;
+      if(p - lo < hi - p) {
+        stack[top].lo = p + 1;
+        stack[top].hi = hi;
+        hi = p;
+      } else {
+        stack[top].lo = lo;
+        stack[top].hi = p;
+        lo = p + 1;
+      }
+      ++top;
+    }
+
+    insertion_sort(s, base + lo * sz, hi - lo, sz);
+
+    if(!top)
+      break;
+    --top;
+    lo = stack[top].lo;
+    hi = stack[top].hi;
+    depth = stack[top].depth;
+  }
+}
+
+static void reverse(char *base, size_t n, size_t sz) {
+  size_t i;
+  for(i = 0; i < n / 2; ++i)
+    swap_elems(base + i * sz, base + (n - 1 - i) * sz, sz);
+}
+
+// Swap adjacent blocks of n1 and n2 elements
+static void rotate(char *base, size_t n1, size_t n2, size_t sz) {
+  reverse(base, n1, sz);
+  reverse(base + n1 * sz, n2, sz);
+  reverse(base, n1 + n2, sz);
+}
+
+// Merge adjacent sorted runs: if one of them fits to buffer
+// merge linearly, otherwise recursively split them
+// and rotate middle parts.
+static void merge_inplace(Sorter *s, char *base, size_t n1, size_t n2, size_t sz) {
+  if(!n1 || !n2)
+    return;
+
+  char *b = base + n1 * sz;
+  if(n1 + n2 == 2) {
+    if(cmp_elems(s, b, base) < 0)
+      swap_elems(base, b, sz);
+    return;
+  }
+
+  if(n1 * sz <= MERGE_BUF_SIZE) {
+    // Forward merge with first run in buffer
+    memcpy(s->buf, base, n1 * sz);
+    char *a = s->buf, *a_end = s->buf + n1 * sz, *b_end = b + n2 * sz, *out = base;
+    while(a < a_end && b < b_end) {
+      if(cmp_elems(s, b, a) < 0) {
+        memmove(out, b, sz);
+        b += sz;
+      } else {
+        memcpy(out, a, sz);
+        a += sz;
+      }
+      out += sz;
+    }
+    memcpy(out, a, a_end - a);
+    return;
+  }
+
+  if(n2 * sz <= MERGE_BUF_SIZE) {
+    // Backward merge with second run in buffer
+    memcpy(s->buf, b, n2 * sz);
+    char *a = b, *bb = s->buf + n2 * sz, *out = b + n2 * sz;
+    while(a > base && bb > s->buf) {
+      out -= sz;
+      if(cmp_elems(s, bb - sz, a - sz) < 0) {
+        a -= sz;
+        memmove(out, a, sz);
+      } else {
+        bb -= sz;
+        memcpy(out, bb, sz);
+      }
+    }
+    memcpy(base, s->buf, bb - s->buf);
+    return;
+  }
+
+  size_t cut1, cut2;
+  if(n1 > n2) {
+    // Lower bound of A[cut1] in B
+    cut1 = n1 / 2;
+    size_t l = 0, h = n2;
+    while(l < h) {
+      size_t m = l + (h - l) / 2;
+      if(cmp_elems(s, b + m * sz, base + cut1 * sz) < 0)
+        l = m + 1;
+      else
+        h = m;
+    }
+    cut2 = l;
+  } else {
+    // Upper bound of B[cut2] in A
+    cut2 = n2 / 2;
+    size_t l = 0, h = n1;
+    while(l < h) {
+      size_t m = l + (h - l) / 2;
+      if(cmp_elems(s, b + cut2 * sz, base + m * sz) >= 0)
+        l = m + 1;
+      else
+        h = m;
+    }
+    cut1 = l;
+  }
+
+  rotate(base + cut1 * sz, n1 - cut1, cut2, sz);
+  merge_inplace(s, base, cut1, cut2, sz);
+  merge_inplace(s, base + (cut1 + cut2) * sz, n1 - cut1, n2 - cut2, sz);
+}
+
+static ALWAYS_INLINE void merge_sort(Sorter *s, char *base, size_t n, size_t sz) {
+  size_t lo, width;
+  for(lo = 0; lo < n; lo += INSERTION_THRESHOLD)
+    insertion_sort(s, base + lo * sz, n - lo < INSERTION_THRESHOLD ? n - lo : INSERTION_THRESHOLD, sz);
+
+  for(width = INSERTION_THRESHOLD; width < n; width *= 2) {
+    for(lo = 0; lo + width < n; lo += 2 * width) {
+      size_t mid = lo + width, hi = mid + width < n ? mid + width : n;
+      char *first = base + lo * sz, *last = base + (hi - 1) * sz;
+
+      // Runs are already ordered
+      if(cmp_elems(s, base + (mid - 1) * sz, base + mid * sz) <= 0)
+        continue;
+
+      merge_inplace(s, first, mid - lo, hi - mid, sz);
+
+      // Merged run can not start with element greater than its last one
+      if(cmp_elems(s, first, last) > 0)
+        invariant_error(s, "comparison function is not transitive");
+    }
+  }
+}
+
+#define DEFINE_SORT(suffix, sz_)                                        \
+  static void introsort_##suffix(Sorter *s, char *base, size_t n, size_t sz) { \
+    (void)sz;                                                           \
+    introsort(s, base, n, sz_);                                         \
+  }                                                                     \
+  static void merge_sort_##suffix(Sorter *s, char *base, size_t n, size_t sz) { \
+    (void)sz;                                                           \
+    merge_sort(s, base, n, sz_);                                        \
+  }
+
+DEFINE_SORT(4, 4)
+DEFINE_SORT(8, 8)
+DEFINE_SORT(generic, sz)
+
+void sort_array(ErrorContext *ctx, const Comparator *cmp, void *data, size_t n, size_t sz, int stable, int check) {
+  if(n < 2 || !sz)
+    return;
+  Sorter s;
+  s.ctx = ctx;
+  s.cmp = cmp;
+  s.check = check;
+  set_dump_input(ctx, cmp, 0, data, 0, n, sz);
+  void (*sort)(Sorter *, char *, size_t, size_t);
+  switch(sz) {
+  case 4:
+    sort = stable ? merge_sort_4 : introsort_4;
+    break;
+  case 8:
+    sort = stable ? merge_sort_8 : introsort_8;
+    break;
+  default:
+    sort = stable ? merge_sort_generic : introsort_generic;
+    break;
+  }
+  sort(&s, data, n, sz);
+  reset_dump_input(ctx);
+}
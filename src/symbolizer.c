@@ -0,0 +1,863 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <symbolizer.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef __APPLE__
+
+#include <link.h>  // ElfW
+
+typedef struct {
+  uintptr_t addr;
+  size_t size;
+  const char *name;
+} Symbol;
+
+typedef struct {
+  uintptr_t addr;
+  const char *file;
+  unsigned line;
+  int end_sequence;
+} LineRow;
+
+// Parsed symbols and line info are stored in a compact
+// position-independent table which is saved to cache directory
+// and memory-mapped on subsequent runs (so that large modules
+// are only parsed once). Table consists of header followed
+// by arrays of symbols and rows and a pool of null-terminated strings.
+
+#define SYM_TABLE_MAGIC "SCSYMS1"
+
+typedef struct {
+  char magic[8];
+  // Identity of module file (table is stale if it changed)
+  uint64_t module_size, module_mtime, module_ino, module_dev;
+  uint64_t load_bias;
+  uint32_t is_dyn;
+  uint32_t pointer_size;
+  uint64_t nsyms, nrows, strs_size;
+} SymTableHeader;
+
+typedef struct {
+  uint64_t addr, size;
+  uint64_t name;  // Offset in string pool
+} TableSym;
+
+typedef struct {
+  uint64_t addr;
+  uint64_t file;  // Offset in string pool
+  uint32_t line;
+  uint32_t end_sequence;
+} TableRow;
+
+typedef struct Module_ {
+  struct Module_ *next;
+  char *path;
+  // Parsing state (released once table is built)
+  const char *image;
+  size_t image_size;
+  int is_dyn;
+  uintptr_t load_bias;  // Address of first segment
+  Symbol *syms;
+  size_t nsyms;
+  LineRow *rows;
+  size_t nrows;
+  // Symbol table (mapped from cache or allocated)
+  const char *table;
+  size_t table_size;
+  int table_mapped;
+} Module;
+
+#define TABLE_HDR(m) ((const SymTableHeader *)(m)->table)
+#define TABLE_SYMS(m) ((const TableSym *)((m)->table + sizeof(SymTableHeader)))
+#define TABLE_ROWS(m) ((const TableRow *)(TABLE_SYMS(m) + TABLE_HDR(m)->nsyms))
+#define TABLE_STRS(m) ((const char *)(TABLE_ROWS(m) + TABLE_HDR(m)->nrows))
+
+static const char *cache_dir;
+
+static Module *modules;
+
+typedef struct {
+  const char *data;
+  size_t size;
+} Section;
+
+static int find_section(const char *image, size_t image_size, const char *name, Section *sec) {
+  const ElfW(Ehdr) *ehdr = (const ElfW(Ehdr) *)image;
+  if(!ehdr->e_shoff || ehdr->e_shstrndx == SHN_UNDEF
+      || ehdr->e_shstrndx >= ehdr->e_shnum
+      || ehdr->e_shoff > image_size
+      || (size_t)ehdr->e_shnum * sizeof(ElfW(Shdr)) > image_size - ehdr->e_shoff)
+    return 0;
+
+  const ElfW(Shdr) *shdrs = (const ElfW(Shdr) *)(image + ehdr->e_shoff);
+  const ElfW(Shdr) *shstr_hdr = &shdrs[ehdr->e_shstrndx];
+  if(shstr_hdr->sh_offset > image_size
+      || shstr_hdr->sh_size > image_size - shstr_hdr->sh_offset)
+    return 0;
+  const char *shstrtab = image + shstr_hdr->sh_offset;
+  size_t shstrtab_size = shstr_hdr->sh_size, name_size = strlen(name) + 1;
+
+  size_t i;
+  for(i = 0; i < ehdr->e_shnum; ++i) {
+    const ElfW(Shdr) *shdr = &shdrs[i];
+    // Compare including null so that name is never read past table end
+    if(shdr->sh_name >= shstrtab_size
+        || name_size > shstrtab_size - shdr->sh_name
+        || 0 != memcmp(shstrtab + shdr->sh_name, name, name_size))
+      continue;
+    if(shdr->sh_type == SHT_NOBITS
+        || shdr->sh_offset > image_size
+        || shdr->sh_size > image_size - shdr->sh_offset
+        || (shdr->sh_flags & SHF_COMPRESSED))  // TODO: support compressed sections
+      return 0;
+    sec->data = image + shdr->sh_offset;
+    sec->size = shdr->sh_size;
+    return 1;
+  }
+
+  return 0;
+}
+
+static int sym_cmp(const void *pa, const void *pb) {
+  const Symbol *a = pa, *b = pb;
+  return a->addr < b->addr ? -1 : a->addr > b->addr ? 1 : 0;
+}
+
+static void read_symbols(Module *m, const char *symtab_name, const char *strtab_name) {
+  Section symtab, strtab;
+  if(!find_section(m->image, m->image_size, symtab_name, &symtab)
+      || !find_section(m->image, m->image_size, strtab_name, &strtab))
+    return;
+
+  const ElfW(Sym) *syms = (const ElfW(Sym) *)symtab.data;
+  size_t nsyms = symtab.size / sizeof(ElfW(Sym));
+
+  m->syms = malloc(nsyms * sizeof(Symbol));
+  m->nsyms = 0;
+
+  size_t i;
+  for(i = 0; i < nsyms; ++i) {
+    const ElfW(Sym) *sym = &syms[i];
+    if(ELF32_ST_TYPE(sym->st_info) != STT_FUNC
+        || sym->st_shndx == SHN_UNDEF
+        || !sym->st_value
+        || sym->st_name >= strtab.size
+        || strnlen(strtab.data + sym->st_name, strtab.size - sym->st_name) == strtab.size - sym->st_name)
+      continue;
+    Symbol *s = &m->syms[m->nsyms++];
+    s->addr = sym->st_value;
+    s->size = sym->st_size;
+    s->name = strtab.data + sym->st_name;
+  }
+
+  qsort(m->syms, m->nsyms, sizeof(Symbol), sym_cmp);
+}
+
+// DWARF decoding helpers
+
+typedef struct {
+  const uint8_t *cur, *end;
+  int is_64;
+  int error;
+} Reader;
+
+static uint64_t read_uint(Reader *r, size_t n) {
+  if(r->error || (size_t)(r->end - r->cur) < n) {
+    r->error = 1;
+    return 0;
+  }
+  uint64_t res = 0;
+  size_t i;
+  for(i = 0; i < n; ++i)  // TODO: big-endian targets
+    res |= (uint64_t)r->cur[i] << (8 * i);
+  r->cur += n;
+  return res;
+}
+
+static uint64_t read_uleb(Reader *r) {
+  uint64_t res = 0;
+  unsigned shift = 0;
+  while(!r->error) {
+    uint8_t b = (uint8_t)read_uint(r, 1);
+    if(shift < 64)
+      res |= (uint64_t)(b & 0x7f) << shift;
+    shift += 7;
+    if(!(b & 0x80))
+      break;
+  }
+  return res;
+}
+
+static int64_t read_sleb(Reader *r) {
+  int64_t res = 0;
+  unsigned shift = 0;
+  uint8_t b = 0;
+  while(!r->error) {
+    b = (uint8_t)read_uint(r, 1);
+    if(shift < 64)
+      res |= (int64_t)(b & 0x7f) << shift;
+    shift += 7;
+    if(!(b & 0x80))
+      break;
+  }
+  if(shift < 64 && (b & 0x40))
+    res |= -((int64_t)1 << shift);
+  return res;
+}
+
+static const char *read_str(Reader *r) {
+  const char *s = (const char *)r->cur;
+  size_t len = strnlen(s, r->end - r->cur);
+  if(len == (size_t)(r->end - r->cur)) {
+    r->error = 1;
+    return "";
+  }
+  r->cur += len + 1;
+  return s;
+}
+
+static const char *section_str(const Section *sec, uint64_t off) {
+  if(!sec->data || off >= sec->size
+      || strnlen(sec->data + off, sec->size - off) == sec->size - off)
+    return "?";
+  return sec->data + off;
+}
+
+enum {
+  DW_FORM_block = 0x09,
+  DW_FORM_data1 = 0x0b,
+  DW_FORM_data2 = 0x05,
+  DW_FORM_data4 = 0x06,
+  DW_FORM_data8 = 0x07,
+  DW_FORM_data16 = 0x1e,
+  DW_FORM_string = 0x08,
+  DW_FORM_strp = 0x0e,
+  DW_FORM_udata = 0x0f,
+  DW_FORM_line_strp = 0x1f,
+  DW_FORM_strx = 0x1a,
+  DW_FORM_strx1 = 0x25,
+  DW_FORM_strx2 = 0x26,
+  DW_FORM_strx3 = 0x27,
+  DW_FORM_strx4 = 0x28,
+};
+
+enum {
+  DW_LNCT_path = 1,
+};
+
+// Read attribute of line table header entry (DWARF 5);
+// returns string (if attribute is a string) or NULL
+static const char *read_form(Reader *r, unsigned form, const Section *str, const Section *line_str) {
+  switch(form) {
+  case DW_FORM_string:
+    return read_str(r);
+  case DW_FORM_strp:
+    return section_str(str, read_uint(r, r->is_64 ? 8 : 4));
+  case DW_FORM_line_strp:
+    return section_str(line_str, read_uint(r, r->is_64 ? 8 : 4));
+  case DW_FORM_strx:
+  case DW_FORM_udata:
+    read_uleb(r);
+    return form == DW_FORM_strx ? "?" : NULL;
+  case DW_FORM_strx1:
+  case DW_FORM_data1:
+    read_uint(r, 1);
+    return form == DW_FORM_strx1 ? "?" : NULL;
+  case DW_FORM_strx2:
+  case DW_FORM_data2:
+    read_uint(r, 2);
+    return form == DW_FORM_strx2 ? "?" : NULL;
+  case DW_FORM_strx3:
+    read_uint(r, 3);
+    return "?";
+  case DW_FORM_strx4:
+  case DW_FORM_data4:
+    read_uint(r, 4);
+    return form == DW_FORM_strx4 ? "?" : NULL;
+  case DW_FORM_data8:
+    read_uint(r, 8);
+    return NULL;
+  case DW_FORM_data16:
+    read_uint(r, 8);
+    read_uint(r, 8);
+    return NULL;
+  case DW_FORM_block: {
+    uint64_t len = read_uleb(r);
+    if(len > (uint64_t)(r->end - r->cur))
+      r->error = 1;
+    else
+      r->cur += len;
+    return NULL;
+  }
+  default:
+    r->error = 1;
+    return NULL;
+  }
+}
+
+static void add_row(Module *m, size_t *capacity, uintptr_t addr, const char *file, unsigned line, int end_sequence) {
+  if(m->nrows >= *capacity) {
+    *capacity = *capacity ? 2 * *capacity : 1024;
+    m->rows = realloc(m->rows, *capacity * sizeof(LineRow));
+  }
+  LineRow *row = &m->rows[m->nrows++];
+  row->addr = addr;
+  row->file = file;
+  row->line = line;
+  row->end_sequence = end_sequence;
+}
+
+// Parse single line number program (unit) from .debug_line
+static void read_line_unit(Module *m, size_t *capacity, Reader *r, const Section *str, const Section *line_str) {
+  unsigned version = (unsigned)read_uint(r, 2);
+  if(version < 2 || version > 5) {
+    r->error = 1;
+    return;
+  }
+
+  unsigned addr_size = sizeof(void *);
+  if(version >= 5) {
+    addr_size = (unsigned)read_uint(r, 1);
+    read_uint(r, 1);  // segment_selector_size
+  }
+
+  uint64_t header_length = read_uint(r, r->is_64 ? 8 : 4);
+  if(header_length > (uint64_t)(r->end - r->cur)) {
+    r->error = 1;
+    return;
+  }
+  const uint8_t *program = r->cur + header_length;
+
+  unsigned min_inst_length = (unsigned)read_uint(r, 1);
+  if(version >= 4)
+    read_uint(r, 1);  // maximum_operations_per_instruction (VLIW only)
+  int default_is_stmt = (int)read_uint(r, 1);
+  int line_base = (int8_t)read_uint(r, 1);
+  unsigned line_range = (unsigned)read_uint(r, 1);
+  unsigned opcode_base = (unsigned)read_uint(r, 1);
+  (void)default_is_stmt;
+
+  uint8_t opcode_lengths[256];
+  unsigned i;
+  for(i = 1; i < opcode_base; ++i)
+    opcode_lengths[i] = (uint8_t)read_uint(r, 1);
+
+  if(r->error || !line_range)
+    return;
+
+  // Collect file names
+
+  size_t nfiles = 0, files_capacity = 16;
+  const char **files = malloc(files_capacity * sizeof(const char *));
+
+  if(version < 5) {
+    // Skip include directories
+    while(!r->error && *read_str(r))
+      ;
+    // Entry 0 is reserved in DWARF 2-4
+    files[nfiles++] = "?";
+    while(!r->error) {
+      const char *name = read_str(r);
+      if(!*name)
+        break;
+      read_uleb(r);  // Directory index
+      read_uleb(r);  // Modification time
+      read_uleb(r);  // File size
+      if(nfiles >= files_capacity) {
+        files_capacity *= 2;
+        files = realloc(files, files_capacity * sizeof(const char *));
+      }
+      files[nfiles++] = name;
+    }
+  } else {
+    unsigned pass;
+    for(pass = 0; pass < 2 && !r->error; ++pass) {  // Directories, then files
+      unsigned formats[16][2];
+      unsigned nformats = (unsigned)read_uint(r, 1);
+      if(nformats > 16) {
+        r->error = 1;
+        break;
+      }
+      for(i = 0; i < nformats; ++i) {
+        formats[i][0] = (unsigned)read_uleb(r);
+        formats[i][1] = (unsigned)read_uleb(r);
+      }
+      uint64_t count = read_uleb(r), j;
+      for(j = 0; j < count && !r->error; ++j) {
+        const char *name = "?";
+        for(i = 0; i < nformats; ++i) {
+          const char *s = read_form(r, formats[i][1], str, line_str);
+          if(formats[i][0] == DW_LNCT_path && s)
+            name = s;
+        }
+        if(pass == 0)
+          continue;
+        if(nfiles >= files_capacity) {
+          files_capacity *= 2;
+          files = realloc(files, files_capacity * sizeof(const char *));
+        }
+        files[nfiles++] = name;
+      }
+    }
+  }
+
+  if(r->error) {
+    free(files);
+    return;
+  }
+
+  // Run line number program
+
+  r->cur = program;
+
+  uintptr_t addr = 0;
+  uint64_t file = 1;
+  int64_t line = 1;
+
+#define FILE_NAME (file < nfiles ? files[file] : "?")
+
+  while(r->cur < r->end && !r->error) {
+    unsigned op = (unsigned)read_uint(r, 1);
+
+    if(op >= opcode_base) {
+      // Special opcode
+      unsigned adj = op - opcode_base;
+      addr += (adj / line_range) * min_inst_length;
+      line += line_base + (int)(adj % line_range);
+      add_row(m, capacity, addr, FILE_NAME, (unsigned)line, 0);
+      continue;
+    }
+
+    switch(op) {
+    case 0: {  // Extended opcode
+      uint64_t len = read_uleb(r);
+      if(!len || len > (uint64_t)(r->end - r->cur)) {
+        r->error = 1;
+        break;
+      }
+      const uint8_t *next = r->cur + len;
+      unsigned sub_op = (unsigned)read_uint(r, 1);
+      switch(sub_op) {
+      case 1:  // DW_LNE_end_sequence
+        add_row(m, capacity, addr, FILE_NAME, (unsigned)line, 1);
+        addr = 0;
+        file = 1;
+        line = 1;
+        break;
+      case 2:  // DW_LNE_set_address
+        addr = (uintptr_t)read_uint(r, len - 1 <= 8 ? len - 1 : addr_size);
+        break;
+      default:  // DW_LNE_define_file, DW_LNE_set_discriminator, etc.
+        break;
+      }
+      r->cur = next;
+      break;
+    }
+    case 1:  // DW_LNS_copy
+      add_row(m, capacity, addr, FILE_NAME, (unsigned)line, 0);
+      break;
+    case 2:  // DW_LNS_advance_pc
+      addr += read_uleb(r) * min_inst_length;
+      break;
+    case 3:  // DW_LNS_advance_line
+      line += read_sleb(r);
+      break;
+    case 4:  // DW_LNS_set_file
+      file = read_uleb(r);
+      break;
+    case 8:  // DW_LNS_const_add_pc
+      addr += ((255 - opcode_base) / line_range) * min_inst_length;
+      break;
+    case 9:  // DW_LNS_fixed_advance_pc
+      addr += read_uint(r, 2);
+      break;
+    default:  // Skip unused standard opcodes
+      for(i = 0; i < opcode_lengths[op]; ++i)
+        read_uleb(r);
+      break;
+    }
+  }
+
+#undef FILE_NAME
+
+  free(files);
+}
+
+static int row_cmp(const void *pa, const void *pb) {
+  const LineRow *a = pa, *b = pb;
+  if(a->addr != b->addr)
+    return a->addr < b->addr ? -1 : 1;
+  // Start of next sequence takes priority over end of previous one
+  return b->end_sequence - a->end_sequence;
+}
+
+static void read_lines(Module *m) {
+  Section line, str = { 0, 0 }, line_str = { 0, 0 };
+  if(!find_section(m->image, m->image_size, ".debug_line", &line))
+    return;
+  find_section(m->image, m->image_size, ".debug_str", &str);
+  find_section(m->image, m->image_size, ".debug_line_str", &line_str);
+
+  size_t capacity = 0;
+  const uint8_t *cur = (const uint8_t *)line.data, *end = cur + line.size;
+  while(cur < end) {
+    Reader r = { cur, end, 0, 0 };
+    uint64_t len = read_uint(&r, 4);
+    if(len == 0xffffffff) {
+      r.is_64 = 1;
+      len = read_uint(&r, 8);
+    }
+    if(r.error || len > (uint64_t)(end - r.cur))
+      break;
+    r.end = r.cur + len;
+    cur = r.end;
+    read_line_unit(m, &capacity, &r, &str, &line_str);
+  }
+
+  qsort(m->rows, m->nrows, sizeof(LineRow), row_cmp);
+}
+
+static void set_module_id(SymTableHeader *h, const struct stat *st) {
+  h->module_size = st->st_size;
+  h->module_mtime = st->st_mtime;
+  h->module_ino = st->st_ino;
+  h->module_dev = st->st_dev;
+}
+
+static int table_valid(const char *table, size_t size, const struct stat *st) {
+  if(size < sizeof(SymTableHeader))
+    return 0;
+  const SymTableHeader *h = (const SymTableHeader *)table;
+  SymTableHeader id;
+  set_module_id(&id, st);
+  if(0 != memcmp(h->magic, SYM_TABLE_MAGIC, sizeof(h->magic))
+      || h->pointer_size != sizeof(void *)
+      || h->module_size != id.module_size
+      || h->module_mtime != id.module_mtime
+      || h->module_ino != id.module_ino
+      || h->module_dev != id.module_dev)
+    return 0;
+  size_t rest = size - sizeof(SymTableHeader);
+  if(h->nsyms > rest / sizeof(TableSym))
+    return 0;
+  rest -= h->nsyms * sizeof(TableSym);
+  if(h->nrows > rest / sizeof(TableRow))
+    return 0;
+  rest -= h->nrows * sizeof(TableRow);
+  // Terminating null guarantees that all offsets in pool are safe
+  return h->strs_size == rest && (!rest || !table[size - 1]);
+}
+
+// Build table from parsed symbols and rows
+static char *build_table(const Module *m, const struct stat *st, size_t *psize) {
+  size_t strs_size = 0, i;
+  for(i = 0; i < m->nsyms; ++i)
+    strs_size += strlen(m->syms[i].name) + 1;
+  // Consecutive rows mostly refer to the same file
+  for(i = 0; i < m->nrows; ++i) {
+    if(!i || m->rows[i].file != m->rows[i - 1].file)
+      strs_size += strlen(m->rows[i].file) + 1;
+  }
+
+  size_t size = sizeof(SymTableHeader) + m->nsyms * sizeof(TableSym) + m->nrows * sizeof(TableRow) + strs_size;
+  char *table = calloc(1, size);
+  if(!table)
+    return NULL;
+
+  SymTableHeader *h = (SymTableHeader *)table;
+  memcpy(h->magic, SYM_TABLE_MAGIC, sizeof(h->magic));
+  set_module_id(h, st);
+  h->load_bias = m->load_bias;
+  h->is_dyn = m->is_dyn;
+  h->pointer_size = sizeof(void *);
+  h->nsyms = m->nsyms;
+  h->nrows = m->nrows;
+  h->strs_size = strs_size;
+
+  TableSym *syms = (TableSym *)(table + sizeof(SymTableHeader));
+  TableRow *rows = (TableRow *)(syms + m->nsyms);
+  char *strs = (char *)(rows + m->nrows);
+  size_t off = 0;
+
+  for(i = 0; i < m->nsyms; ++i) {
+    syms[i].addr = m->syms[i].addr;
+    syms[i].size = m->syms[i].size;
+    syms[i].name = off;
+    size_t len = strlen(m->syms[i].name) + 1;
+    memcpy(strs + off, m->syms[i].name, len);
+    off += len;
+  }
+
+  for(i = 0; i < m->nrows; ++i) {
+    rows[i].addr = m->rows[i].addr;
+    rows[i].line = m->rows[i].line;
+    rows[i].end_sequence = m->rows[i].end_sequence;
+    if(i && m->rows[i].file == m->rows[i - 1].file) {
+      rows[i].file = rows[i - 1].file;
+      continue;
+    }
+    rows[i].file = off;
+    size_t len = strlen(m->rows[i].file) + 1;
+    memcpy(strs + off, m->rows[i].file, len);
+    off += len;
+  }
+
+  *psize = size;
+  return table;
+}
+
+// Name of cache file: basename of module and hash of full path
+static void get_cache_path(const char *module, char *buf, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ull;  // FNV-1a
+  const char *p;
+  for(p = module; *p; ++p)
+    hash = (hash ^ (unsigned char)*p) * 0x100000001b3ull;
+  const char *base = strrchr(module, '/');
+  snprintf(buf, size, "%s/%s-%016llx.sym", cache_dir, base ? base + 1 : module, (unsigned long long)hash);
+}
+
+static const char *load_table(const char *cache_path, const struct stat *module_st, size_t *psize) {
+  int fd = open(cache_path, O_RDONLY);
+  if(fd < 0)
+    return NULL;
+
+  struct stat st;
+  void *table = MAP_FAILED;
+  if(0 == fstat(fd, &st) && st.st_size > 0)
+    table = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(table == MAP_FAILED)
+    return NULL;
+
+  if(!table_valid(table, st.st_size, module_st)) {
+    munmap(table, st.st_size);
+    return NULL;
+  }
+
+  *psize = st.st_size;
+  return table;
+}
+
+static void make_dirs(const char *dir) {
+  char buf[PATH_MAX];
+  snprintf(buf, sizeof(buf), "%s", dir);
+  char *p;
+  for(p = buf + 1; *p; ++p) {
+    if(*p == '/') {
+      *p = 0;
+      mkdir(buf, 0777);
+      *p = '/';
+    }
+  }
+  mkdir(buf, 0777);
+}
+
+// Cache is best effort so errors are ignored
+static void save_table(const char *cache_path, const char *table, size_t size) {
+  make_dirs(cache_dir);
+
+  // Write to temp file so that concurrent readers never see partial table
+  char tmp_path[PATH_MAX + 32];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", cache_path, (long)getpid());
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0)
+    return;
+  int ok = write(fd, table, size) == (ssize_t)size;
+  close(fd);
+  if(!ok || 0 != rename(tmp_path, cache_path))
+    unlink(tmp_path);
+}
+
+static int parse_module(Module *m, int fd, const struct stat *st) {
+  void *image = mmap(0, st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(image == MAP_FAILED)
+    return 0;
+
+  const ElfW(Ehdr) *ehdr = image;
+  if(0 != memcmp(ehdr->e_ident, ELFMAG, SELFMAG)
+      || ehdr->e_ident[EI_CLASS] != (sizeof(void *) == 8 ? ELFCLASS64 : ELFCLASS32)
+      || ehdr->e_phoff > (size_t)st->st_size
+      || (size_t)ehdr->e_phnum * sizeof(ElfW(Phdr)) > (size_t)st->st_size - ehdr->e_phoff) {
+    munmap(image, st->st_size);
+    return 0;
+  }
+
+  m->image = image;
+  m->image_size = st->st_size;
+  m->is_dyn = ehdr->e_type == ET_DYN;
+
+  // Reports contain offsets from first mapped segment
+  const ElfW(Phdr) *phdrs = (const ElfW(Phdr) *)((const char *)image + ehdr->e_phoff);
+  size_t i;
+  for(i = 0; i < ehdr->e_phnum; ++i) {
+    if(phdrs[i].p_type == PT_LOAD) {
+      m->load_bias = phdrs[i].p_vaddr & ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1);
+      break;
+    }
+  }
+
+  read_symbols(m, ".symtab", ".strtab");
+  if(!m->nsyms)
+    read_symbols(m, ".dynsym", ".dynstr");
+
+  read_lines(m);
+
+  m->table = build_table(m, st, &m->table_size);
+
+  // Table owns copies of all strings
+  free(m->syms);
+  m->syms = NULL;
+  free(m->rows);
+  m->rows = NULL;
+  munmap(image, st->st_size);
+  m->image = NULL;
+
+  return m->table != NULL;
+}
+
+static Module *open_module(const char *path) {
+  Module *m;
+  for(m = modules; m; m = m->next) {
+    if(0 == strcmp(m->path, path))
+      return m->table ? m : NULL;
+  }
+
+  m = calloc(1, sizeof(Module));
+  m->path = strdup(path);
+  m->next = modules;
+  modules = m;
+
+  int fd = open(path, O_RDONLY);
+  if(fd < 0)
+    return NULL;
+
+  struct stat st;
+  if(0 != fstat(fd, &st) || (size_t)st.st_size < sizeof(ElfW(Ehdr))) {
+    close(fd);
+    return NULL;
+  }
+
+  char cache_path[PATH_MAX];
+  if(cache_dir) {
+    get_cache_path(path, cache_path, sizeof(cache_path));
+    m->table = load_table(cache_path, &st, &m->table_size);
+    if(m->table) {
+      m->table_mapped = 1;
+      close(fd);
+      return m;
+    }
+  }
+
+  int ok = parse_module(m, fd, &st);
+  close(fd);
+  if(!ok)
+    return NULL;
+
+  if(cache_dir)
+    save_table(cache_path, m->table, m->table_size);
+
+  return m;
+}
+
+void set_symbolizer_cache(const char *dir) {
+  cache_dir = dir && *dir ? dir : NULL;
+}
+
+int symbolize(const char *module, size_t offset, SymbolInfo *info) {
+  info->func = 0;
+  info->file = 0;
+  info->line = 0;
+
+  Module *m = open_module(module);
+  if(!m)
+    return 0;
+
+  const SymTableHeader *h = TABLE_HDR(m);
+  const TableSym *syms = TABLE_SYMS(m);
+  const TableRow *rows = TABLE_ROWS(m);
+  const char *strs = TABLE_STRS(m);
+
+  uint64_t addr = h->is_dyn ? h->load_bias + offset : offset;
+
+  // Find last symbol which starts before addr
+  size_t lo = 0, hi = h->nsyms;
+  while(lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if(syms[mid].addr <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if(lo) {
+    const TableSym *s = &syms[lo - 1];
+    if((!s->size || addr < s->addr + s->size) && s->name < h->strs_size)
+      info->func = strs + s->name;
+  }
+
+  // Same for line info
+  lo = 0;
+  hi = h->nrows;
+  while(lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if(rows[mid].addr <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if(lo && !rows[lo - 1].end_sequence && rows[lo - 1].file < h->strs_size) {
+    info->file = strs + rows[lo - 1].file;
+    info->line = rows[lo - 1].line;
+  }
+
+  return info->func || info->file;
+}
+
+void release_symbolizer(void) {
+  while(modules) {
+    Module *m = modules;
+    modules = m->next;
+    if(m->table_mapped)
+      munmap((void *)m->table, m->table_size);
+    else
+      free((void *)m->table);
+    free(m->path);
+    free(m);
+  }
+}
+
+#else
+
+// TODO: support Mach-O
+
+int symbolize(const char *module, size_t offset, SymbolInfo *info) {
+  (void)module;
+  (void)offset;
+  info->func = 0;
+  info->file = 0;
+  info->line = 0;
+  return 0;
+}
+
+void set_symbolizer_cache(const char *dir) {
+  (void)dir;
+}
+
+void release_symbolizer(void) {}
+
+#endif
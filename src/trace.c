@@ -0,0 +1,209 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Recording of workload traces (trace=PREFIX).
+// Each thread appends records to its own memory-mapped file
+// so recording needs neither locks nor syscalls in common case.
+
+#include <checker.h>
+#include <checksum.h>
+#include <proc_info.h>
+#include <trace.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Files are extended (and mapped) in chunks of this size
+#define TRACE_CHUNK (1 << 20)
+
+typedef struct {
+  int state;  // 0 - not opened, 1 - opened, -1 - failed or closed
+  int fd;
+  char *chunk;  // Currently mapped chunk
+  size_t chunk_off;  // Offset of chunk in file
+  size_t size;  // Used part of file
+} ThreadTrace;
+
+static __thread ThreadTrace tt;
+
+static pthread_key_t trace_key;
+
+static void trace_close(void *arg) {
+  (void)arg;
+  if(tt.state <= 0)
+    return;
+  munmap(tt.chunk, TRACE_CHUNK);
+  // Drop unused tail of last chunk
+  if(ftruncate(tt.fd, tt.size)) {}
+  close(tt.fd);
+  tt.state = -1;
+}
+
+// Main thread does not run key destructors
+static void trace_close_main(void) {
+  trace_close(0);
+}
+
+// Trace of parent thread belongs to parent
+static void reset_after_fork(void) {
+  if(tt.state > 0) {
+    munmap(tt.chunk, TRACE_CHUNK);
+    close(tt.fd);
+  }
+  memset(&tt, 0, sizeof(tt));
+}
+
+static void trace_init_once(void) {
+  pthread_key_create(&trace_key, trace_close);
+  pthread_atfork(0, 0, reset_after_fork);
+  atexit(trace_close_main);
+}
+
+static int map_chunk(size_t off) {
+  if(ftruncate(tt.fd, off + TRACE_CHUNK))
+    return 0;
+  void *p = mmap(0, TRACE_CHUNK, PROT_READ | PROT_WRITE, MAP_SHARED, tt.fd, off);
+  if(p == MAP_FAILED)
+    return 0;
+  tt.chunk = p;
+  tt.chunk_off = off;
+  return 1;
+}
+
+static int trace_open(void) {
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, trace_init_once);
+
+  char fname[PATH_MAX];
+  snprintf(fname, sizeof(fname), "%s.%ld.%lu", flags.trace_prefix, (long)getpid(), get_thread_id());
+  tt.fd = open(fname, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(tt.fd < 0 || !map_chunk(0)) {
+    if(flags.debug)
+      fprintf(stderr, "sortcheck: failed to create trace %s\n", fname);
+    if(tt.fd >= 0)
+      close(tt.fd);
+    tt.state = -1;
+    return 0;
+  }
+  tt.state = 1;
+
+  TraceHeader *h = (TraceHeader *)tt.chunk;
+  memcpy(h->magic, TRACE_MAGIC, sizeof(h->magic));
+  h->version = 1;
+  h->record_size = sizeof(TraceRecord);
+  h->pid = getpid();
+  h->tid = get_thread_id();
+  tt.size = sizeof(TraceHeader);
+
+  pthread_setspecific(trace_key, &tt);
+  return 1;
+}
+
+static TraceFunc get_trace_func(const char *func) {
+  static const char *const names[NUM_TRACE_FUNCS] = {
+    "", "qsort", "qsort_r", "heapsort", "mergesort", "bsearch", "lfind", "lsearch"
+  };
+  int i;
+  for(i = 1; i < NUM_TRACE_FUNCS; ++i) {
+    if(0 == strcmp(func, names[i]))
+      return i;
+  }
+  return TRACE_NONE;
+}
+
+static uint32_t hash_module(const char *module) {
+  return (uint32_t)fnv1a(FNV1A_INIT, module, strlen(module));
+}
+
+// Read modules cached in callsite (returns 0 on miss)
+static int lookup_modules(Callsite *cs, const void *cmp, TraceRecord *r) {
+  unsigned seq = __atomic_load_n(&cs->trace_seq, __ATOMIC_ACQUIRE);
+  if(seq & 1)
+    return 0;
+  int hit = __atomic_load_n(&cs->trace_gen, __ATOMIC_RELAXED) == dlopen_gen
+            && __atomic_load_n(&cs->trace_cmp, __ATOMIC_RELAXED) == cmp;
+  r->cmp_module = __atomic_load_n(&cs->trace_cmp_module, __ATOMIC_RELAXED);
+  r->cmp_offset = __atomic_load_n(&cs->trace_cmp_offset, __ATOMIC_RELAXED);
+  r->caller_module = __atomic_load_n(&cs->trace_caller_module, __ATOMIC_RELAXED);
+  r->caller_offset = __atomic_load_n(&cs->trace_caller_offset, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return hit && __atomic_load_n(&cs->trace_seq, __ATOMIC_RELAXED) == seq;
+}
+
+// Slow path: resolve modules (needs update of process maps)
+// and cache them in callsite
+static void resolve_modules(Callsite *cs, const void *cmp, const void *ret_addr, TraceRecord *r) {
+  int gen = dlopen_gen;
+  const void *addrs[2] = { cmp, ret_addr };
+  const char *modules[2];
+  size_t offsets[2];
+  get_module_offsets(addrs, 2, modules, offsets);
+  r->cmp_offset = offsets[0];
+  r->cmp_module = hash_module(modules[0]);
+  r->caller_offset = offsets[1];
+  r->caller_module = hash_module(modules[1]);
+
+  // Concurrent updaters simply skip caching
+  unsigned seq = __atomic_load_n(&cs->trace_seq, __ATOMIC_RELAXED);
+  if((seq & 1) || !__atomic_compare_exchange_n(&cs->trace_seq, &seq, seq + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    return;
+  __atomic_store_n(&cs->trace_gen, gen, __ATOMIC_RELAXED);
+  __atomic_store_n(&cs->trace_cmp, cmp, __ATOMIC_RELAXED);
+  __atomic_store_n(&cs->trace_cmp_module, r->cmp_module, __ATOMIC_RELAXED);
+  __atomic_store_n(&cs->trace_cmp_offset, r->cmp_offset, __ATOMIC_RELAXED);
+  __atomic_store_n(&cs->trace_caller_module, r->caller_module, __ATOMIC_RELAXED);
+  __atomic_store_n(&cs->trace_caller_offset, r->caller_offset, __ATOMIC_RELAXED);
+  __atomic_store_n(&cs->trace_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void trace_call(const ErrorContext *ctx, const TraceSpan *t, size_t n, size_t sz) {
+  uint64_t end = trace_now();
+
+  if(tt.state < 0 || (!tt.state && !trace_open()))
+    return;
+
+  TraceFunc func = get_trace_func(ctx->func);
+  if(func == TRACE_NONE)
+    return;
+
+  // Move to next chunk
+  if(tt.size + sizeof(TraceRecord) > tt.chunk_off + TRACE_CHUNK) {
+    munmap(tt.chunk, TRACE_CHUNK);
+    if(!map_chunk(tt.chunk_off + TRACE_CHUNK)) {
+      close(tt.fd);
+      tt.state = -1;
+      return;
+    }
+  }
+
+  TraceRecord *r = (TraceRecord *)(tt.chunk + (tt.size - tt.chunk_off));
+  // Modules are only resolved on first call from callsite
+  // (calls which can not be tracked are recorded without modules)
+  Callsite *cs = ctx->callsite ? ctx->callsite : get_callsite(ctx->ret_addr);
+  if(!cs) {
+    r->cmp_module = r->caller_module = 0;
+    r->cmp_offset = r->caller_offset = 0;
+  } else if(!lookup_modules(cs, ctx->cmp_addr, r))
+    resolve_modules(cs, ctx->cmp_addr, ctx->ret_addr, r);
+  r->timestamp = t->start;
+  r->n = n;
+  r->sz = sz;
+  r->real_ns = t->real_end - t->real_start;
+  r->check_ns = (end - t->start) - r->real_ns;
+  r->found_error = ctx->found_error;
+  // Written last so that partial records are ignored
+  __atomic_store_n(&r->func, func, __ATOMIC_RELEASE);
+
+  tt.size += sizeof(TraceRecord);
+}
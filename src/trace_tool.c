@@ -0,0 +1,379 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Offline processing of workload traces recorded via trace=PREFIX:
+// prints summary of recorded calls and replays them as synthetic
+// benchmark with the same distribution of functions, sizes
+// and (optionally) timing. Running benchmark under LD_PRELOAD
+// allows to evaluate checker changes on production-shaped load.
+
+#include <io.h>
+#include <trace.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <search.h>
+
+#include <unistd.h>
+
+#define NUM_BUCKETS 32
+
+// Limits on replayed arrays (larger records are considered corrupted)
+#define MAX_REPLAY_SZ (1 << 20)
+#define MAX_REPLAY_BYTES ((uint64_t)SIZE_MAX < (1ull << 34) ? (uint64_t)SIZE_MAX / 2 : (1ull << 34))
+
+static const char *const func_names[NUM_TRACE_FUNCS] = {
+  "", "qsort", "qsort_r", "heapsort", "mergesort", "bsearch", "lfind", "lsearch"
+};
+
+typedef struct {
+  const char *fname;
+  char *buf;
+  const TraceRecord *recs;
+  size_t nrecs, cur;
+} Trace;
+
+typedef struct {
+  size_t ncalls, nerrors;
+  uint64_t sum_n, max_n, sum_sz, max_sz;
+  size_t n_hist[NUM_BUCKETS];
+  uint64_t real_ns, check_ns;
+  uint64_t replay_ns;
+} FuncStats;
+
+static FuncStats stats[NUM_TRACE_FUNCS];
+
+static void usage(const char *prog) {
+  printf("\
+Usage: %s [OPTION]... TRACE...\n\
+Summarize workload TRACEs recorded by sortcheck (trace option)\n\
+and replay them as synthetic benchmark with the same functions,\n\
+array sizes and element sizes (run under LD_PRELOAD\n\
+to measure checker overhead). Replayed elements are random\n\
+and calls come from a few fixed callsites so per-callsite\n\
+and per-array caches (incremental, start=rotate, bsearch_cache,\n\
+lsearch_cache, tiered) never hit and their effect\n\
+is not measured.\n\
+\n\
+Options:\n\
+  -s         Only print summary, do not replay.\n\
+  -n CALLS   Replay at most CALLS calls.\n\
+  -t         Preserve recorded gaps between calls.\n\
+  -S SEED    Seed for generated elements (default 0).\n\
+  -h         Print this help and exit.\n\
+", prog);
+}
+
+static unsigned log2_bucket(uint64_t n) {
+  unsigned b = 0;
+  while(n > 1 && b + 1 < NUM_BUCKETS) {
+    n >>= 1;
+    ++b;
+  }
+  return b;
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int read_trace(const char *fname, Trace *t) {
+  memset(t, 0, sizeof(*t));
+  t->fname = fname;
+
+  size_t size;
+  t->buf = read_file(fname, &size);
+  if(!t->buf || size < sizeof(TraceHeader))
+    goto bad;
+
+  const TraceHeader *h = (const TraceHeader *)t->buf;
+  if(0 != memcmp(h->magic, TRACE_MAGIC, sizeof(h->magic)) || h->version != 1
+      || h->record_size != sizeof(TraceRecord))
+    goto bad;
+
+  t->recs = (const TraceRecord *)(t->buf + sizeof(TraceHeader));
+  size_t max_recs = (size_t)(size - sizeof(TraceHeader)) / sizeof(TraceRecord);
+  // Trace of killed process may end with zeroed records
+  while(t->nrecs < max_recs && t->recs[t->nrecs].func != TRACE_NONE) {
+    const TraceRecord *r = &t->recs[t->nrecs];
+    // Replay allocates room for element appended by lsearch
+    // (product does not overflow because of limits on factors)
+    if(r->func >= NUM_TRACE_FUNCS || r->sz > MAX_REPLAY_SZ || r->n > MAX_REPLAY_BYTES
+        || (r->n + 1) * r->sz > MAX_REPLAY_BYTES)
+      goto bad;
+    ++t->nrecs;
+  }
+  return 1;
+
+bad:
+  free(t->buf);
+  t->buf = 0;
+  return 0;
+}
+
+static void add_stats(const TraceRecord *r) {
+  FuncStats *s = &stats[r->func];
+  ++s->ncalls;
+  s->nerrors += r->found_error;
+  s->sum_n += r->n;
+  if(r->n > s->max_n)
+    s->max_n = r->n;
+  s->sum_sz += r->sz;
+  if(r->sz > s->max_sz)
+    s->max_sz = r->sz;
+  ++s->n_hist[log2_bucket(r->n)];
+  s->real_ns += r->real_ns;
+  s->check_ns += r->check_ns;
+}
+
+static void print_summary(void) {
+  int i;
+  unsigned b;
+  printf("%-10s %10s %10s %10s %8s %8s %12s %12s %7s\n",
+         "func", "calls", "avg n", "max n", "avg sz", "max sz", "libc ms", "check ms", "errors");
+  for(i = 1; i < NUM_TRACE_FUNCS; ++i) {
+    const FuncStats *s = &stats[i];
+    if(!s->ncalls)
+      continue;
+    printf("%-10s %10zu %10llu %10llu %8llu %8llu %12.3f %12.3f %7zu\n",
+           func_names[i], s->ncalls,
+           (unsigned long long)(s->sum_n / s->ncalls), (unsigned long long)s->max_n,
+           (unsigned long long)(s->sum_sz / s->ncalls), (unsigned long long)s->max_sz,
+           s->real_ns / 1e6, s->check_ns / 1e6, s->nerrors);
+  }
+  for(i = 1; i < NUM_TRACE_FUNCS; ++i) {
+    const FuncStats *s = &stats[i];
+    if(!s->ncalls)
+      continue;
+    printf("%s n histogram:", func_names[i]);
+    for(b = 0; b < NUM_BUCKETS; ++b) {
+      if(s->n_hist[b])
+        printf(" [%llu, %llu): %zu", b ? 1ull << b : 0, 1ull << (b + 1), s->n_hist[b]);
+    }
+    printf("\n");
+  }
+}
+
+// Synthetic elements are compared by (up to) 8-byte prefix
+// so cost of comparison does not depend on element size.
+static size_t key_size;
+
+static int synth_cmp(const void *a, const void *b) {
+  return memcmp(a, b, key_size);
+}
+
+static int synth_cmp_r(const void *a, const void *b, void *arg) {
+  return memcmp(a, b, *(const size_t *)arg);
+}
+
+static uint64_t rng_state;
+
+static uint64_t rng(void) {
+  // xorshift64*
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 0x2545f4914f6cdd1dull;
+}
+
+static void fill_random(char *data, size_t size) {
+  size_t i;
+  for(i = 0; i + 8 <= size; i += 8) {
+    uint64_t v = rng();
+    memcpy(data + i, &v, 8);
+  }
+  for(; i < size; ++i)
+    data[i] = (char)rng();
+}
+
+// Returns time spent in replayed function
+static uint64_t replay_call(const TraceRecord *r, char *data, char *key) {
+  size_t n = r->n, sz = r->sz, lsearch_n = n;
+  key_size = sz < 8 ? sz : 8;
+
+  fill_random(data, n * sz);
+  switch(r->func) {
+  case TRACE_BSEARCH:
+    // Sorting is not timed
+    qsort(data, n, sz, synth_cmp);
+    // FALLTHROUGH
+  case TRACE_LFIND:
+  case TRACE_LSEARCH:
+    // Search for existing element
+    memcpy(key, data + (n ? rng() % n : 0) * sz, n ? sz : 0);
+    break;
+  }
+
+  uint64_t start = now_ns();
+  switch(r->func) {
+  case TRACE_QSORT:
+    qsort(data, n, sz, synth_cmp);
+    break;
+  case TRACE_QSORT_R:
+#ifdef __linux__
+    qsort_r(data, n, sz, synth_cmp_r, &key_size);
+#else
+    (void)synth_cmp_r;
+    qsort(data, n, sz, synth_cmp);
+#endif
+    break;
+  case TRACE_HEAPSORT:
+  case TRACE_MERGESORT:
+#ifdef __linux__
+    // Glibc does not provide BSD sorts
+    qsort(data, n, sz, synth_cmp);
+#else
+    if(r->func == TRACE_HEAPSORT)
+      heapsort(data, n, sz, synth_cmp);
+    else
+      mergesort(data, n, sz, synth_cmp);
+#endif
+    break;
+  case TRACE_BSEARCH:
+    bsearch(key, data, n, sz, synth_cmp);
+    break;
+  case TRACE_LFIND:
+    lfind(key, data, &lsearch_n, sz, synth_cmp);
+    break;
+  case TRACE_LSEARCH:
+    lsearch(key, data, &lsearch_n, sz, synth_cmp);
+    break;
+  }
+  return now_ns() - start;
+}
+
+// Returns next record in timestamp order (over all threads)
+static const TraceRecord *next_record(Trace *traces, size_t ntraces) {
+  Trace *best = 0;
+  size_t i;
+  for(i = 0; i < ntraces; ++i) {
+    Trace *t = &traces[i];
+    if(t->cur < t->nrecs && (!best || t->recs[t->cur].timestamp < best->recs[best->cur].timestamp))
+      best = t;
+  }
+  return best ? &best->recs[best->cur++] : 0;
+}
+
+static void sleep_ns(uint64_t ns) {
+  struct timespec ts = { ns / 1000000000, ns % 1000000000 };
+  nanosleep(&ts, 0);
+}
+
+static void replay(Trace *traces, size_t ntraces, size_t max_calls, int keep_gaps) {
+  // Buffers are allocated once for the largest call
+  uint64_t max_bytes = 1, max_sz = 1;
+  size_t i, ncalls = 0;
+  for(i = 1; i < NUM_TRACE_FUNCS; ++i) {
+    if(stats[i].max_sz > max_sz)
+      max_sz = stats[i].max_sz;
+  }
+  for(i = 0; i < ntraces; ++i) {
+    size_t j;
+    for(j = 0; j < traces[i].nrecs; ++j) {
+      const TraceRecord *r = &traces[i].recs[j];
+      // Room for element appended by lsearch
+      uint64_t bytes = (r->n + 1) * r->sz;
+      if(bytes > max_bytes)
+        max_bytes = bytes;
+    }
+  }
+  char *data = malloc(max_bytes), *key = malloc(max_sz);
+  if(!data || !key) {
+    fprintf(stderr, "sortcheck-trace: failed to allocate %llu bytes\n", (unsigned long long)max_bytes);
+    exit(1);
+  }
+
+  const TraceRecord *r;
+  uint64_t prev_ts = 0, prev_end = 0;
+  while(ncalls < max_calls && (r = next_record(traces, ntraces))) {
+    if(keep_gaps && prev_ts) {
+      uint64_t gap = r->timestamp - prev_ts, elapsed = now_ns() - prev_end;
+      if(gap > elapsed)
+        sleep_ns(gap - elapsed);
+    }
+    stats[r->func].replay_ns += replay_call(r, data, key);
+    prev_ts = r->timestamp;
+    prev_end = now_ns();
+    ++ncalls;
+  }
+
+  printf("replayed %zu call(s)\n", ncalls);
+  printf("%-10s %14s %14s %14s\n", "func", "recorded ms", "(libc ms)", "replay ms");
+  for(i = 1; i < NUM_TRACE_FUNCS; ++i) {
+    const FuncStats *s = &stats[i];
+    if(!s->ncalls)
+      continue;
+    printf("%-10s %14.3f %14.3f %14.3f\n", func_names[i],
+           (s->real_ns + s->check_ns) / 1e6, s->real_ns / 1e6, s->replay_ns / 1e6);
+  }
+
+  free(data);
+  free(key);
+}
+
+int main(int argc, char *argv[]) {
+  int summary_only = 0, keep_gaps = 0;
+  size_t max_calls = SIZE_MAX;
+  rng_state = 0;
+
+  int opt;
+  while((opt = getopt(argc, argv, "sn:tS:h")) != -1) {
+    switch(opt) {
+    case 's':
+      summary_only = 1;
+      break;
+    case 'n':
+      max_calls = strtoull(optarg, 0, 0);
+      break;
+    case 't':
+      keep_gaps = 1;
+      break;
+    case 'S':
+      rng_state = strtoull(optarg, 0, 0);
+      break;
+    case 'h':
+      usage(argv[0]);
+      return 0;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if(optind >= argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // Xorshift state must be non-zero
+  rng_state = rng_state * 0x9e3779b97f4a7c15ull + 1;
+
+  size_t ntraces = argc - optind, i, j;
+  Trace *traces = calloc(ntraces, sizeof(Trace));
+  for(i = 0; i < ntraces; ++i) {
+    if(!read_trace(argv[optind + i], &traces[i])) {
+      fprintf(stderr, "sortcheck-trace: failed to read trace %s\n", argv[optind + i]);
+      return 1;
+    }
+    for(j = 0; j < traces[i].nrecs; ++j)
+      add_stats(&traces[i].recs[j]);
+  }
+
+  print_summary();
+  if(!summary_only)
+    replay(traces, ntraces, max_calls, keep_gaps);
+
+  for(i = 0; i < ntraces; ++i)
+    free(traces[i].buf);
+  free(traces);
+  return 0;
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Wrapper for link-time interposition in libsortcheck.a
+// (link with -Wl,--wrap=bsearch).
+// Each wrapper is a separate archive member so that __real_bsearch
+// is only referenced when corresponding --wrap is used.
+
+#include <platform.h>
+
+#include <stddef.h>
+
+typedef int (*cmp_fun_t)(const void *, const void *);
+
+typedef void *bsearch_fun_t(const void *key, const void *data, size_t n, size_t sz, cmp_fun_t cmp);
+
+EXPORT bsearch_fun_t __wrap_bsearch;
+
+extern bsearch_fun_t __real_bsearch;
+
+// Implemented in api.c
+extern void *__sortcheck_bsearch(const void *key, const void *data, size_t n, size_t sz, cmp_fun_t cmp, bsearch_fun_t *real, const void *ret_addr);
+
+EXPORT void *__wrap_bsearch(const void *key, const void *data, size_t n, size_t sz, cmp_fun_t cmp) {
+  return __sortcheck_bsearch(key, data, n, sz, cmp, __real_bsearch, __builtin_return_address(0));
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+// Wrapper for link-time interposition in libsortcheck.a
+// (link with -Wl,--wrap=qsort).
+// Each wrapper is a separate archive member so that __real_qsort
+// is only referenced when corresponding --wrap is used.
+
+#include <platform.h>
+
+#include <stddef.h>
+
+typedef int (*cmp_fun_t)(const void *, const void *);
+
+typedef void qsort_fun_t(void *data, size_t n, size_t sz, cmp_fun_t cmp);
+
+EXPORT qsort_fun_t __wrap_qsort;
+
+extern qsort_fun_t __real_qsort;
+
+// Implemented in api.c
+extern void __sortcheck_qsort(void *data, size_t n, size_t sz, cmp_fun_t cmp, qsort_fun_t *real, const void *ret_addr);
+
+EXPORT void __wrap_qsort(void *data, size_t n, size_t sz, cmp_fun_t cmp) {
+  __sortcheck_qsort(data, n, sz, cmp, __real_qsort, __builtin_return_address(0));
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <sortcheck.h>
+
+#define N 1000
+
+int aa[N];
+
+// Comparator is not symmetric for equal elements
+// SKIP: mac
+// CFLAGS: -Iinclude bin/libsortcheck.a -lpthread
+// CHECK: sortcheck_verify: comparison function is not symmetric
+// CHECK: sortcheck_verify_sorted: processed array is not sorted
+int cmp(const void *pa, const void *pb, void *arg) {
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  (void)arg;
+  return a <= b ? -1 : 1;
+}
+
+int main() {
+  int i;
+  for(i = 0; i < N; ++i)
+    aa[i] = i % 10;
+  // Small budget so that whole array is not checked at once
+  for(i = 0; i < 10; ++i) {
+    if(sortcheck_verify(aa, N, sizeof(int), cmp, 0, 200))
+      break;
+  }
+  return !sortcheck_verify_sorted(aa, N, sizeof(int), cmp, 0, 0);
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+char aa[] = { 1, 2, 3 };
+
+// Errors from different stacks are reported separately
+// OPTS: backtrace=4
+// CFLAGS: -fno-omit-frame-pointer -fno-inline
+// CHECK: qsort: comparison function returns unstable results (.*, backtrace 0x.*
+// CHECK: reports: 2
+int cmp(const void *pa, const void *pb) {
+  static int x;
+  return x++ % 2;
+}
+
+void do_sort() {
+  qsort(aa, sizeof(aa), 1, cmp);
+}
+
+void f1() {
+  do_sort();
+}
+
+void f2() {
+  do_sort();
+}
+
+int main() {
+  // Collect reports in temp file
+  FILE *log = tmpfile();
+  int old_stderr = dup(2);
+  dup2(fileno(log), 2);
+
+  int i;
+  for(i = 0; i < 2; ++i) {
+    f1();
+    f2();
+  }
+
+  dup2(old_stderr, 2);
+
+  char buf[1024];
+  int nreports = 0;
+  rewind(log);
+  while(fgets(buf, sizeof(buf), log)) {
+    fputs(buf, stderr);
+    if(strstr(buf, "unstable"))
+      ++nreports;
+  }
+  fprintf(stderr, "reports: %d\n", nreports);
+
+  return 0;
+}
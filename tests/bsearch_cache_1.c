@@ -0,0 +1,45 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#define N 1000
+
+int aa[N];
+int ncalls;
+
+// Repeated lookups in verified array are cheap
+// OPTS: bsearch_cache=1
+int cmp(const void *pa, const void *pb) {
+  ++ncalls;
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  return a < b ? -1 : a > b;
+}
+
+int main() {
+  int i;
+  for(i = 0; i < N; ++i)
+    aa[i] = i;
+
+  int key = 10;
+  bsearch(&key, aa, N, sizeof(int), cmp);
+
+  ncalls = 0;
+  for(i = 0; i < 10; ++i) {
+    key = i;
+    bsearch(&key, aa, N, sizeof(int), cmp);
+  }
+
+  if(ncalls > 200) {
+    fprintf(stderr, "too many comparisons: %d\n", ncalls);
+    return 1;
+  }
+
+  return 0;
+}
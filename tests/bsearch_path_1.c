@@ -0,0 +1,34 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+#define N 1000
+
+int aa[N];
+
+// Array consists of two sorted halves in wrong order
+// OPTS: bsearch_path=1
+// CHECK: bsearch: processed array is not sorted
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  return a < b ? -1 : a > b;
+}
+
+int main() {
+  int i;
+  for(i = 0; i < N; ++i)
+    aa[i] = (i + N / 2) % N;
+
+  for(i = 0; i < 20; ++i) {
+    int key = N / 2 + i * 10;
+    bsearch(&key, aa, N, sizeof(int), cmp);
+  }
+
+  return 0;
+}
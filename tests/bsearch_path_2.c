@@ -0,0 +1,41 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#define N (1 << 16)
+
+int aa[N];
+int ncalls;
+
+// Checking cost is logarithmic
+// OPTS: bsearch_path=1
+int cmp(const void *pa, const void *pb) {
+  ++ncalls;
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  return a < b ? -1 : a > b;
+}
+
+int main() {
+  int i;
+  for(i = 0; i < N; ++i)
+    aa[i] = 2 * i;
+
+  for(i = 0; i < 100; ++i) {
+    int key = i * 1001;  // Both present and missing keys
+    ncalls = 0;
+    bsearch(&key, aa, N, sizeof(int), cmp);
+    if(ncalls > 8 * 16) {
+      fprintf(stderr, "too many comparisons: %d\n", ncalls);
+      return 1;
+    }
+  }
+
+  return 0;
+}
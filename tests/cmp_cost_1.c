@@ -0,0 +1,42 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+#define N 16
+
+int aa[N];
+
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa, b = *(const int *)pb;
+  return a < b ? -1 : a > b;
+}
+
+static void fill(void) {
+  int i;
+  for(i = 0; i < N; ++i)
+    aa[i] = N - i;
+}
+
+// Builtin engine uses insertion sort for small arrays
+// which makes N^2/2 comparisons on reversed input
+// and this is expected
+// OPTS: cmp_cost=1:replace_sort=1
+// CHECK-NOT: excessive number of comparisons
+// CHECK: comparator cost for
+// CHECK: callsite .*: 1 calls, 120 comparisons (1.00x of expected), .* ticks per comparison
+// CHECK: callsite .*: 1 calls, 28 comparisons (1.00x of expected), .* ticks per comparison
+// CHECK: callsite .*: 1 calls, 6 comparisons (1.00x of expected), .* ticks per comparison
+int main() {
+  fill();
+  qsort(aa, N, sizeof(int), cmp);
+  fill();
+  qsort(aa, N / 2, sizeof(int), cmp);
+  fill();
+  qsort(aa, N / 4, sizeof(int), cmp);
+  return 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+#ifdef LIB
+
+typedef struct {
+  int key;
+  double weight;
+} Item;
+
+// Overflows on large keys
+int item_cmp(const void *pa, const void *pb) {
+  const Item *a = pa, *b = pb;
+  return a->key != b->key ? a->key - b->key : a->weight < b->weight ? -1 : a->weight > b->weight;
+}
+
+#else
+
+// SKIP: bsd, asan
+// CHECK: fuzz: comparison function is not
+// CHECK: failing input .* saved to bin/fuzz_1.bin
+int main() {
+  return !system("cc -shared -fPIC -DLIB tests/fuzz_1.c -o bin/fuzz_1.so"
+                 " && bin/sortcheck-fuzz -l i32,f64 -i 100000 -o bin/fuzz_1.bin bin/fuzz_1.so item_cmp");
+}
+
+#endif
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+#define N 1000
+#define BAD (N + 5)
+
+int aa[N + 10];
+
+// Element appended to the end of large array is outside of default window
+// but is checked against old elements when array is re-sorted
+// OPTS: incremental=1
+// CHECK: comparison function is not symmetric
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  if(a == BAD || b == BAD)
+    return a == b ? 0 : -1;
+  return a < b ? -1 : a > b;
+}
+
+int main() {
+  int i;
+  for(i = 0; i < N; ++i)
+    aa[i] = N - i;
+  qsort(aa, N, sizeof(int), cmp);
+  for(i = N; i < N + 10; ++i) {
+    aa[i] = i;
+    qsort(aa, i + 1, sizeof(int), cmp);
+  }
+  return 0;
+}
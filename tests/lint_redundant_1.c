@@ -0,0 +1,31 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+#define N 100
+
+int aa[N];
+
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa, b = *(const int *)pb;
+  return a < b ? -1 : a > b;
+}
+
+// OPTS: lint=redundant
+// CHECK: redundant sorts: 0 of 3 calls sort already sorted input, 2 sort same content as previous call
+// CHECK: redundant sorts: 1 of 1 calls sort already sorted input, 0 sort same content as previous call (~700 comparisons
+int main() {
+  int i, k;
+  for(k = 0; k < 3; ++k) {
+    for(i = 0; i < N; ++i)
+      aa[i] = (i * 7) % N;
+    qsort(aa, N, sizeof(int), cmp);
+  }
+  qsort(aa, N, sizeof(int), cmp);
+  return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+#include <search.h>
+
+#define N 1000
+
+int aa[N];
+
+struct { int key; char payload[4096]; } big[16];
+
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa, b = *(const int *)pb;
+  return a < b ? -1 : a > b;
+}
+
+// OPTS: lint=usage
+// CHECK: #1 callsite .*: lfind: 100 calls
+// CHECK: linear search over n~1000 called 100 times
+// CHECK: #2 callsite .*: qsort: 1 calls
+// CHECK: sort of 4100-byte elements
+// CHECK: #3 callsite .*: bsearch: 10 calls
+// CHECK: binary search over n~3
+int main() {
+  int i;
+  for(i = 0; i < N; ++i)
+    aa[i] = i;
+
+  size_t n = N;
+  for(i = 0; i < 100; ++i) {
+    int key = N - 1 - i;
+    lfind(&key, aa, &n, sizeof(int), cmp);
+  }
+
+  for(i = 0; i < 16; ++i)
+    big[i].key = 16 - i;
+  qsort(big, 16, sizeof(big[0]), cmp);
+
+  for(i = 0; i < 10; ++i) {
+    int key = i % 3;
+    bsearch(&key, aa, 3, sizeof(int), cmp);
+  }
+
+  return 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <search.h>
+
+#define N 500
+#define BAD (N - 10)
+
+int aa[N];
+
+// Only newly appended elements are fully checked
+// in subsequent calls so error is still found
+// CHECK: lsearch: comparison function returns unstable results
+int cmp(const void *pa, const void *pb) {
+  static int flip;
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  if(b == BAD)
+    return (flip ^= 1) ? 1 : -1;
+  return a != b;
+}
+
+int main() {
+  size_t n = 0;
+  int i;
+  for(i = 0; i < N; ++i)
+    lsearch(&i, aa, &n, sizeof(int), cmp);
+  return 0;
+}
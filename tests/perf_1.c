@@ -0,0 +1,24 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+int aa[] = { 3, 2, 1 };
+
+// Counters may be unavailable (e.g. in VMs) but report is always printed
+// OPTS: perf=1
+// CHECK: sortcheck: perf counters for
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  return a < b ? -1 : a > b;
+}
+
+int main() {
+  qsort(aa, sizeof(aa) / sizeof(aa[0]), sizeof(aa[0]), cmp);
+  return 0;
+}
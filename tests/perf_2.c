@@ -0,0 +1,53 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <dirent.h>
+
+#define NTHREADS 32
+
+int aa[] = { 3, 2, 1 };
+
+// Counters of finished threads are closed
+// REQUIRE: proc
+// OPTS: perf=1
+// CFLAGS: -pthread
+// CHECK: leaked fds: 0
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  return a < b ? -1 : a > b;
+}
+
+static void *sort(void *arg) {
+  (void)arg;
+  qsort(aa, sizeof(aa) / sizeof(aa[0]), sizeof(aa[0]), cmp);
+  return 0;
+}
+
+static int count_fds(void) {
+  DIR *d = opendir("/proc/self/fd");
+  int n = 0;
+  while(readdir(d))
+    ++n;
+  closedir(d);
+  return n;
+}
+
+int main() {
+  sort(0);
+  int before = count_fds(), i;
+  for(i = 0; i < NTHREADS; ++i) {
+    pthread_t t;
+    pthread_create(&t, 0, sort, 0);
+    pthread_join(t, 0);
+  }
+  fprintf(stderr, "leaked fds: %d\n", count_fds() - before);
+  return 0;
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+int aa[] = { 1, 2, 1, 2, 1, 2, 1, 2 };
+
+// Checks are disabled for main executable
+// REQUIRE: proc
+// OPTS: policy=*/libfoo.so;check=all:policy=*/a.out;check=none
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  return a <= b ? -1 : 1;
+}
+
+int main() {
+  qsort(aa, sizeof(aa) / sizeof(aa[0]), sizeof(aa[0]), cmp);
+  return 0;
+}
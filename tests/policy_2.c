@@ -0,0 +1,27 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+int aa[] = { 1, 2, 1, 2, 1, 2, 1, 2 };
+
+// Only basic checks for main executable
+// REQUIRE: proc
+// OPTS: policy=*/a.out;check=basic
+// CHECK: comparison function returns unstable results
+// CHECK-NOT: not symmetric
+int cmp(const void *pa, const void *pb) {
+  static int x;
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  return a == b ? x++ % 2 : a < b ? -1 : 1;
+}
+
+int main() {
+  qsort(aa, sizeof(aa) / sizeof(aa[0]), sizeof(aa[0]), cmp);
+  return 0;
+}
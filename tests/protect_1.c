@@ -0,0 +1,31 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+#define N 4096
+
+// Span several full pages
+int aa[N] __attribute__((aligned(4096)));
+
+// Comparator writes to element in the middle of array
+// OPTS: protect=1
+// CHECK: comparison function modifies data
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  aa[N / 2] = aa[N / 2];
+  return a < b ? -1 : a > b;
+}
+
+int main() {
+  int i;
+  for(i = 0; i < N; ++i)
+    aa[i] = i;
+  qsort(aa, N, sizeof(int), cmp);
+  return 0;
+}
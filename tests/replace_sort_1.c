@@ -0,0 +1,28 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+#define N 100
+
+int aa[N];
+
+// Builtin engine detects inconsistent comparator without extra checks
+// OPTS: replace_sort=1:check=none
+// CHECK: partition invariant violated
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa, b = *(const int *)pb;
+  return a < b ? 1 : -1;  // Never returns 0 and is not symmetric for equal elements
+}
+
+int main() {
+  int i;
+  for(i = 0; i < N; ++i)
+    aa[i] = i % 3;
+  qsort(aa, N, sizeof(aa[0]), cmp);
+  return 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifdef LIB
+
+// Close elements are considered equal
+int fuzzy_cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa, b = *(const int *)pb;
+  return a - b <= 1 && b - a <= 1 ? 0 : a < b ? -1 : 1;
+}
+
+#else
+
+#include <stdlib.h>
+#include <dlfcn.h>
+
+// SKIP: bsd, asan
+// OPTS: dump_dir=bin/replay_1.d
+// CFLAGS: -ldl
+// CHECK: qsort: comparison function is not transitive
+// CHECK: error reproduced
+// CHECK: not transitive: cmp(#0, #1) = 0, cmp(#1, #2) = 0, cmp(#0, #2) = 1
+// CHECK: minimal counterexample (3 elements) saved to bin/replay_1.bin
+int main() {
+  if(system("rm -rf bin/replay_1.d && cc -shared -fPIC -DLIB tests/replay_1.c -o bin/replay_1.so"))
+    return 1;
+
+  void *h = dlopen("bin/replay_1.so", RTLD_NOW);
+  if(!h)
+    return 1;
+  int (*cmp)(const void *, const void *) = (int (*)(const void *, const void *))dlsym(h, "fuzzy_cmp");
+
+  int aa[10] = { 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+  qsort(aa, 10, sizeof(int), cmp);
+
+  // Replay tool returns non-zero on found violations
+  system("bin/sortcheck-replay -j 2 -o bin/replay_1.bin bin/replay_1.d/*.bin >&2; rm -rf bin/replay_1.d");
+  return 0;
+}
+
+#endif
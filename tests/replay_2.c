@@ -0,0 +1,45 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#ifdef LIB
+
+int int_cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa, b = *(const int *)pb;
+  return a < b ? -1 : a > b;
+}
+
+#else
+
+#include <stdlib.h>
+#include <dlfcn.h>
+
+// Errors are dumped (with bsearch key) even if they are not reported
+// SKIP: bsd, asan
+// OPTS: dump_dir=bin/replay_2.d:report_error=0:check=default,good_bsearch
+// CFLAGS: -ldl
+// CHECK: bsearch: processed array is not sorted
+// CHECK: key: 05 00 00 00
+// CHECK: error reproduced
+int main() {
+  if(system("rm -rf bin/replay_2.d && cc -shared -fPIC -DLIB tests/replay_2.c -o bin/replay_2.so"))
+    return 1;
+
+  void *h = dlopen("bin/replay_2.so", RTLD_NOW);
+  if(!h)
+    return 1;
+  int (*cmp)(const void *, const void *) = (int (*)(const void *, const void *))dlsym(h, "int_cmp");
+
+  int aa[10] = { 0, 1, 2, 3, 9, 5, 6, 7, 8, 4 };
+  int key = 5;
+  bsearch(&key, aa, 10, sizeof(int), cmp);
+
+  // Replay tool returns non-zero on found violations
+  system("bin/sortcheck-replay bin/replay_2.d/*.bin >&2; rm -rf bin/replay_2.d");
+  return 0;
+}
+
+#endif
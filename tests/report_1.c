@@ -0,0 +1,31 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+char aa[] = { 1, 2, 3 };
+
+// REQUIRE: proc
+// SKIP: bsd, asan
+
+// OPTS: print_to_file=bin/report_1.log
+// CFLAGS: -g
+// CHECK: qsort: comparison function returns unstable results
+// CHECK: reported 1 time(s) by 1 process(es) (a.out)
+// CHECK: comparison function .*/a.out+0x[0-9a-f]* in cmp at .*report_1.c:[0-9]
+// CHECK: called from .*/a.out+0x[0-9a-f]* in main at .*report_1.c:[0-9]
+int cmp(const void *pa, const void *pb) {
+  static int x;
+  return x++ % 2;
+}
+
+int main() {
+  unlink("bin/report_1.log");
+  qsort(aa, sizeof(aa), 1, cmp);
+  return system("bin/sortcheck-report bin/report_1.log >&2");
+}
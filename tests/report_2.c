@@ -0,0 +1,35 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+char aa[] = { 1, 2, 3 };
+
+// REQUIRE: proc
+// SKIP: bsd, asan
+
+// Second run of sortcheck-report symbolizes from cache
+// OPTS: print_to_file=bin/report_2.log
+// CFLAGS: -g
+// CHECK: cache: a.out-[0-9a-f]*.sym
+// CHECK: cached: comparison function .*/a.out+0x[0-9a-f]* in cmp at .*report_2.c:[0-9]
+// CHECK: cached: called from .*/a.out+0x[0-9a-f]* in main at .*report_2.c:[0-9]
+int cmp(const void *pa, const void *pb) {
+  static int x;
+  return x++ % 2;
+}
+
+int main() {
+  unlink("bin/report_2.log");
+  qsort(aa, sizeof(aa), 1, cmp);
+  return system("rm -rf bin/report_2.d"
+                " && bin/sortcheck-report -C bin/report_2.d bin/report_2.log >/dev/null"
+                " && ls bin/report_2.d | sed 's/^/cache: /' >&2"
+                " && bin/sortcheck-report -C bin/report_2.d bin/report_2.log | sed 's/^ */cached: /' >&2"
+                " && rm -rf bin/report_2.d");
+}
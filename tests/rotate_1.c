@@ -0,0 +1,35 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+#define N 1000
+
+int aa[N];
+
+// Error is far from array start so it's only found
+// after several calls
+// OPTS: start=rotate:print_stats=1
+// CHECK: comparison function is not transitive
+// CHECK: callsite .*: 40 calls, 20 checked, window coverage 62.5% (20 of 32 windows)
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  if(a == N / 2 || b == N / 2)
+    return 0;
+  return a < b ? -1 : a > b;
+}
+
+int main() {
+  int i, k;
+  for(k = 0; k < 40; ++k) {
+    for(i = 0; i < N; ++i)
+      aa[i] = i;
+    qsort(aa, N, sizeof(int), cmp);
+  }
+  return 0;
+}
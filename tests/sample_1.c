@@ -0,0 +1,33 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+#define N 100000
+
+int aa[N];
+
+// Only sample of elements is checked but error is still found
+// OPTS: sample=100:print_stats=1
+// CHECK: comparison function returns unstable results
+// CHECK: callsite .*: 1 calls, 1 checked, 1 sampled checks \(miss probability up to 99\.9% per call\)
+int cmp(const void *pa, const void *pb) {
+  static int flip;
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  if(a % 10 == 9 || b % 10 == 9)
+    return (flip ^= 1) ? -1 : 1;
+  return a < b ? -1 : a > b;
+}
+
+int main() {
+  int i;
+  for(i = 0; i < N; ++i)
+    aa[i] = N - i;
+  qsort(aa, N, sizeof(int), cmp);
+  return 0;
+}
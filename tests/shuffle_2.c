@@ -23,6 +23,10 @@ int cmp(const void *pa, const void *pb) {
 }
 
 int main() {
-  qsort(aa, sizeof(aa), 1, cmp);
+  // Permutation differs for each call
+  // so the bad element is eventually checked
+  int i;
+  for(i = 0; i < 8; ++i)
+    qsort(aa, sizeof(aa), 1, cmp);
   return 0;
 }
@@ -0,0 +1,31 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+char aa[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+// Shuffling must not modify user data
+// OPTS: shuffle=1
+int cmp(const void *pa, const void *pb) {
+  int i;
+  for(i = 0; i < (int)sizeof(aa); ++i) {
+    if(aa[i] != i + 1) {
+      fprintf(stderr, "array modified\n");
+      exit(1);
+    }
+  }
+  char a = *(const char *)pa;
+  char b = *(const char *)pb;
+  return a < b ? -1 : a == b ? 0 : 1;
+}
+
+int main() {
+  qsort(aa, sizeof(aa), 1, cmp);
+  return 0;
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+int aa[1000];
+
+// Wide window checked in parallel
+// OPTS: threads=4:window=64
+// CHECK: comparison function is not symmetric
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  if(a == 50 || b == 50)
+    return 1;
+  return a < b ? -1 : a > b;
+}
+
+int main() {
+  int i;
+  for(i = 0; i < 1000; ++i)
+    aa[i] = i;
+  qsort(aa, 1000, sizeof(int), cmp);
+  return 0;
+}
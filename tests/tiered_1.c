@@ -0,0 +1,34 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+#define N 100
+#define BAD 90
+
+int aa[N];
+
+// Ties between distinct integers escalate comparator to deep tier
+// whose large window covers element which is not transitive
+// OPTS: tiered=1
+// CHECK: comparison function is not transitive
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa, b = *(const int *)pb;
+  if(a == BAD || b == BAD)
+    return 0;
+  return a / 10 < b / 10 ? -1 : a / 10 > b / 10;
+}
+
+int main() {
+  int i, k;
+  for(k = 0; k < 10; ++k) {
+    for(i = 0; i < N; ++i)
+      aa[i] = i;
+    qsort(aa, N, sizeof(aa[0]), cmp);
+  }
+  return 0;
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+#define N 100
+#define BAD 90
+
+struct { int key, id; } aa[N];
+
+// Ties between key-compared structs are not an anomaly
+// so comparator stays at tier 0
+// OPTS: tiered=1
+// CHECK-NOT: comparison function
+int cmp(const void *pa, const void *pb) {
+  const int *a = pa, *b = pb;
+  if(a[1] == BAD || b[1] == BAD)
+    return 0;
+  return a[0] < b[0] ? -1 : a[0] > b[0];
+}
+
+int main() {
+  int i, k;
+  for(k = 0; k < 10; ++k) {
+    for(i = 0; i < N; ++i) {
+      aa[i].key = i / 10;
+      aa[i].id = i;
+    }
+    qsort(aa, N, sizeof(aa[0]), cmp);
+  }
+  return 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define N 100
+
+int aa[N];
+
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa, b = *(const int *)pb;
+  return a < b ? -1 : a > b;
+}
+
+// SKIP: bsd
+// OPTS: trace=bin/trace_1
+// CHECK: qsort *5 *100 *100 *4 *4
+// CHECK: bsearch *10 *100 *100 *4 *4
+// CHECK: qsort n histogram: .64, 128.: 5
+// CHECK: replayed 15 call.s.
+int main() {
+  int i, j;
+  for(i = 0; i < 5; ++i) {
+    for(j = 0; j < N; ++j)
+      aa[j] = rand();
+    qsort(aa, N, sizeof(int), cmp);
+    bsearch(&aa[i], aa, N, sizeof(int), cmp);
+    bsearch(&aa[N - i - 1], aa, N, sizeof(int), cmp);
+  }
+
+  // Records are visible in mapped file before trace is closed
+  // (main thread's id matches pid on Linux)
+  char cmd[256];
+  snprintf(cmd, sizeof(cmd), "SORTCHECK_OPTIONS= bin/sortcheck-trace bin/trace_1.%ld.%ld >&2; rm -f bin/trace_1.%ld.%ld",
+           (long)getpid(), (long)getpid(), (long)getpid(), (long)getpid());
+  return system(cmd) != 0;
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+int aa[] = { 5, 4, 3, 2, 1, 5, 4, 3, 2, 1 };
+
+// Comparator is not symmetric for equal elements.
+// Program is linked statically (LD_PRELOAD does not work).
+// SKIP: mac, asan
+// CFLAGS: -static -Wl,--wrap=qsort,--wrap=bsearch bin/libsortcheck.a -lpthread
+// CHECK: qsort: comparison function is not symmetric
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa;
+  int b = *(const int *)pb;
+  return a <= b ? -1 : 1;
+}
+
+int main() {
+  qsort(aa, sizeof(aa) / sizeof(aa[0]), sizeof(aa[0]), cmp);
+  return 0;
+}
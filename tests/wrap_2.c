@@ -0,0 +1,44 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#define N 1000
+
+int aa[N];
+int ncalls;
+
+// Link-time wrappers support the same options as interceptors.
+// SKIP: mac, asan
+// OPTS: bsearch_cache=1
+// CFLAGS: -static -Wl,--wrap=qsort,--wrap=bsearch bin/libsortcheck.a -lpthread
+int cmp(const void *pa, const void *pb) {
+  ++ncalls;
+  int a = *(const int *)pa, b = *(const int *)pb;
+  return a < b ? -1 : a > b;
+}
+
+int main() {
+  int i;
+  for(i = 0; i < N; ++i)
+    aa[i] = N - i;
+  qsort(aa, N, sizeof(int), cmp);
+
+  bsearch(&aa[0], aa, N, sizeof(int), cmp);
+
+  ncalls = 0;
+  for(i = 0; i < 10; ++i)
+    bsearch(&aa[i], aa, N, sizeof(int), cmp);
+
+  if(ncalls > 200) {
+    fprintf(stderr, "too many comparisons: %d\n", ncalls);
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2024 Yury Gribov
+ * 
+ * Use of this source code is governed by MIT license that can be
+ * found in the LICENSE.txt file.
+ */
+
+#include <stdlib.h>
+
+#define N 1000
+
+int aa[N];
+
+// Link-time wrappers support the same options as interceptors.
+// SKIP: mac, asan
+// OPTS: lint=usage:cmp_cost=4
+// CFLAGS: -static -Wl,--wrap=qsort,--wrap=bsearch bin/libsortcheck.a -lpthread
+// CHECK: sortcheck: comparator cost for
+// CHECK: sortcheck: lint results for
+// CHECK: bsearch: 10 calls
+int cmp(const void *pa, const void *pb) {
+  int a = *(const int *)pa, b = *(const int *)pb;
+  return a < b ? -1 : a > b;
+}
+
+int main() {
+  int i;
+  for(i = 0; i < N; ++i)
+    aa[i] = N - i;
+  qsort(aa, N, sizeof(int), cmp);
+  for(i = 0; i < 10; ++i)
+    bsearch(&aa[i], aa, N, sizeof(int), cmp);
+  return 0;
+}